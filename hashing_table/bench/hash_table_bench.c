@@ -0,0 +1,142 @@
+#define _POSIX_C_SOURCE 199309L
+#include "hash_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef HASH_TABLE_ENGINE
+#define HASH_TABLE_ENGINE "chained"
+#endif
+
+/** BENCHMARK **/
+typedef struct {
+    int key;
+    int value;
+} bench_entry_t;
+
+static int bench_hash(void *entry) {
+    return ((bench_entry_t *)entry)->key;
+}
+
+static bool bench_compare(void *entry1, void *entry2) {
+    return ((bench_entry_t *)entry1)->key == ((bench_entry_t *)entry2)->key;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void shuffle(int *order, int n) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+/* Inserts n keys into a table that starts at 16 buckets, looks every key up
+ * once in random order (one by one, then as one batch), looks up n absent
+ * keys, removes everything and inserts it back as one batch. */
+static int run(int n) {
+    bench_entry_t *entries = malloc(n * sizeof(bench_entry_t));
+    bench_entry_t *probes = malloc(n * sizeof(bench_entry_t));
+    int *order = malloc(n * sizeof(int));
+    void **keys = malloc(n * sizeof(void *));
+    void **results = malloc(n * sizeof(void *));
+    hash_table_t *table = NULL;
+    if (!entries || !probes || !order || !keys || !results || hash_table_create(16, bench_hash, bench_compare, &table) != DSA_OK) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        entries[i].key = i * 2;
+        entries[i].value = i;
+        order[i] = i;
+    }
+    shuffle(order, n);
+
+    double start = now_ns();
+    for (int i = 0; i < n; i++) {
+        hash_table_insert(table, &entries[order[i]]);
+    }
+    double insert_ns = (now_ns() - start) / n;
+
+    shuffle(order, n);
+    for (int i = 0; i < n; i++) {
+        probes[i].key = entries[order[i]].key;
+    }
+    long found = 0;
+    start = now_ns();
+    for (int i = 0; i < n; i++) {
+        found += hash_table_find(table, &probes[i]) != NULL;
+    }
+    double hit_ns = (now_ns() - start) / n;
+
+    for (int i = 0; i < n; i++) {
+        keys[i] = &probes[i];
+    }
+    start = now_ns();
+    hash_table_find_batch(table, keys, n, results);
+    double batch_hit_ns = (now_ns() - start) / n;
+    for (int i = 0; i < n; i++) {
+        found += results[i] == &entries[order[i]];
+    }
+
+    for (int i = 0; i < n; i++) {
+        probes[i].key = entries[order[i]].key + 1;
+    }
+    start = now_ns();
+    for (int i = 0; i < n; i++) {
+        found -= hash_table_find(table, &probes[i]) != NULL;
+    }
+    double miss_ns = (now_ns() - start) / n;
+
+    shuffle(order, n);
+    start = now_ns();
+    for (int i = 0; i < n; i++) {
+        hash_table_remove(table, &entries[order[i]]);
+    }
+    double remove_ns = (now_ns() - start) / n;
+
+    shuffle(order, n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = &entries[order[i]];
+    }
+    start = now_ns();
+    hash_table_insert_batch(table, keys, n, NULL);
+    double batch_insert_ns = (now_ns() - start) / n;
+    found -= hash_table_size(table);
+
+    printf("%-8s %10d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", HASH_TABLE_ENGINE, n, insert_ns, hit_ns,
+           batch_hit_ns, miss_ns, remove_ns, batch_insert_ns);
+    if (found != n) {
+        fprintf(stderr, "Benchmark result mismatch\n");
+        return 1;
+    }
+
+    hash_table_destroy(table);
+    free(results);
+    free(keys);
+    free(order);
+    free(probes);
+    free(entries);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int max_n = argc > 1 ? atoi(argv[1]) : 4000000;
+
+    printf("%-8s %10s %10s %10s %10s %10s %10s %10s\n", "engine", "entries", "insert_ns", "hit_ns", "bhit_ns",
+           "miss_ns", "remove_ns", "binsert_ns");
+    int n = 1000;
+    for (; n < max_n; n *= 10) {
+        if (run(n) != 0) {
+            return 1;
+        }
+    }
+    return run(max_n);
+}
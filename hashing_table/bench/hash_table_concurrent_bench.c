@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 199309L
+#include "hash_table_concurrent.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEYS (1 << 20)
+#define TOTAL_OPS 4000000
+#define STRESS_THREADS 8
+#define STRESS_ROUNDS 20
+#define STRESS_KEYS_PER_THREAD 20000
+
+#define MODE_NAME(mode) ((mode) == HASH_TABLE_CONCURRENT_LOCKED ? "locked" : "read_mostly")
+
+/** BENCHMARK **/
+typedef struct {
+    int key;
+    int value;
+} bench_entry_t;
+
+typedef struct {
+    hash_table_concurrent_t *table;
+    bench_entry_t *entries;
+    unsigned int seed;
+    int ops;
+    int write_percent;
+    int id;
+    int threads;
+    long found;
+    long errors;
+} bench_thread_t;
+
+static int bench_hash(void *entry) {
+    return ((bench_entry_t *)entry)->key;
+}
+
+static bool bench_compare(void *entry1, void *entry2) {
+    return ((bench_entry_t *)entry1)->key == ((bench_entry_t *)entry2)->key;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned int xorshift(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Random keys over the whole key space; write_percent of the operations are
+ * split evenly between inserts and removes, the rest are lookups. */
+static void *mixed_worker(void *arg) {
+    bench_thread_t *thread = arg;
+    long found = 0;
+
+    for (int i = 0; i < thread->ops; i++) {
+        unsigned int r = xorshift(&thread->seed);
+        bench_entry_t *entry = &thread->entries[r % KEYS];
+        int op = (r >> 20) % 100;
+        if (op < thread->write_percent / 2) {
+            hash_table_concurrent_insert(thread->table, entry);
+        } else if (op < thread->write_percent) {
+            hash_table_concurrent_remove(thread->table, entry);
+        } else {
+            found += hash_table_concurrent_find(thread->table, entry) != NULL;
+        }
+    }
+    thread->found = found;
+    return NULL;
+}
+
+/* Runs TOTAL_OPS operations split across `threads` threads on a table holding
+ * every other key. Returns million operations per second. */
+static double run_mixed(bench_entry_t *entries, hash_table_concurrent_mode_t mode, int threads, int write_percent) {
+    hash_table_concurrent_t *table = NULL;
+    if (hash_table_concurrent_create_with_mode(KEYS, bench_hash, bench_compare, mode, &table) != DSA_OK) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < KEYS; i += 2) {
+        hash_table_concurrent_insert(table, &entries[i]);
+    }
+
+    pthread_t ids[threads];
+    bench_thread_t args[threads];
+    double start = now_ns();
+    for (int t = 0; t < threads; t++) {
+        args[t] = (bench_thread_t){table, entries, 0x9e3779b9u * (t + 1), TOTAL_OPS / threads, write_percent, t, threads, 0, 0};
+        pthread_create(&ids[t], NULL, mixed_worker, &args[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    double elapsed_ns = now_ns() - start;
+
+    hash_table_concurrent_destroy(table);
+    return (double)(TOTAL_OPS / threads) * threads / elapsed_ns * 1e3;
+}
+
+/** STRESS TEST **/
+/* Every thread owns the keys congruent to its id, so it knows exactly what
+ * the table must return for them while the other threads churn the same
+ * segments (and resize them) around it. */
+static void *stress_worker(void *arg) {
+    bench_thread_t *thread = arg;
+    hash_table_concurrent_t *table = thread->table;
+
+    for (int round = 0; round < STRESS_ROUNDS; round++) {
+        for (int k = thread->id; k < thread->threads * STRESS_KEYS_PER_THREAD; k += thread->threads) {
+            thread->errors += hash_table_concurrent_insert(table, &thread->entries[k]) != DSA_OK;
+        }
+        for (int k = thread->id; k < thread->threads * STRESS_KEYS_PER_THREAD; k += thread->threads) {
+            bench_entry_t probe = {k, 0};
+            thread->errors += hash_table_concurrent_find(table, &probe) != &thread->entries[k];
+            thread->errors += hash_table_concurrent_insert(table, &probe) != DSA_EXISTS;
+        }
+        for (int k = thread->id; k < thread->threads * STRESS_KEYS_PER_THREAD; k += thread->threads) {
+            bench_entry_t probe = {k, 0};
+            thread->errors += hash_table_concurrent_remove(table, &probe) != DSA_OK;
+            thread->errors += hash_table_concurrent_find(table, &probe) != NULL;
+        }
+    }
+    return NULL;
+}
+
+static void count_entry(void *entry) {
+    (void)entry;
+}
+
+static void *stress_walker(void *arg) {
+    bench_thread_t *thread = arg;
+    for (int i = 0; i < thread->ops; i++) {
+        hash_table_concurrent_foreach(thread->table, count_entry);
+        if (hash_table_concurrent_size(thread->table) > (size_t)KEYS) {
+            thread->errors++;
+        }
+    }
+    return NULL;
+}
+
+static int run_stress(bench_entry_t *entries, hash_table_concurrent_mode_t mode) {
+    hash_table_concurrent_t *table = NULL;
+    if (hash_table_concurrent_create_with_mode(16, bench_hash, bench_compare, mode, &table) != DSA_OK) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    pthread_t ids[STRESS_THREADS + 1];
+    bench_thread_t args[STRESS_THREADS + 1];
+    for (int t = 0; t <= STRESS_THREADS; t++) {
+        args[t] = (bench_thread_t){table, entries, 0, 50, 0, t, STRESS_THREADS, 0, 0};
+        pthread_create(&ids[t], NULL, t < STRESS_THREADS ? stress_worker : stress_walker, &args[t]);
+    }
+    long errors = 0;
+    for (int t = 0; t <= STRESS_THREADS; t++) {
+        pthread_join(ids[t], NULL);
+        errors += args[t].errors;
+    }
+    if (hash_table_concurrent_size(table) != 0) {
+        errors++;
+    }
+    hash_table_concurrent_destroy(table);
+
+    printf("stress %-11s: %d threads x %d rounds x %d keys, %ld errors\n", MODE_NAME(mode), STRESS_THREADS,
+           STRESS_ROUNDS, STRESS_KEYS_PER_THREAD, errors);
+    return errors != 0;
+}
+
+int main(int argc, char **argv) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 64;
+
+    bench_entry_t *entries = malloc(KEYS * sizeof(bench_entry_t));
+    if (!entries) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < KEYS; i++) {
+        entries[i].key = i;
+        entries[i].value = i;
+    }
+
+    if (run_stress(entries, HASH_TABLE_CONCURRENT_LOCKED) != 0 ||
+        run_stress(entries, HASH_TABLE_CONCURRENT_READ_MOSTLY) != 0) {
+        fprintf(stderr, "Stress test failed\n");
+        return 1;
+    }
+
+    /* Throughput in million operations per second: read-only, 2% and 20% writes. */
+    printf("%-11s %-8s %10s %10s %10s\n", "mode", "threads", "read_mops", "w2_mops", "w20_mops");
+    for (int m = 0; m < 2; m++) {
+        hash_table_concurrent_mode_t mode = m == 0 ? HASH_TABLE_CONCURRENT_LOCKED : HASH_TABLE_CONCURRENT_READ_MOSTLY;
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            printf("%-11s %-8d %10.2f %10.2f %10.2f\n", MODE_NAME(mode), threads, run_mixed(entries, mode, threads, 0),
+                   run_mixed(entries, mode, threads, 2), run_mixed(entries, mode, threads, 20));
+        }
+    }
+
+    free(entries);
+    return 0;
+}
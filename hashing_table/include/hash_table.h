@@ -12,6 +12,28 @@
  */
 typedef struct hash_table hash_table_t;
 
+/**
+ * @brief Load factor (entries per bucket) above which the table doubles its capacity.
+ */
+#define HASH_TABLE_DEFAULT_MAX_LOAD_FACTOR 1.0f
+
+/**
+ * @brief Load factor below which the table halves its capacity
+ * (never below the initial capacity).
+ */
+#define HASH_TABLE_DEFAULT_MIN_LOAD_FACTOR 0.125f
+
+/**
+ * @brief How a resize moves the entries to the new bucket array.
+ */
+typedef enum {
+    /** Both arrays stay live; every insert, find and remove migrates a bounded
+     *  number of buckets, so no single call pays for the whole resize (default). */
+    HASH_TABLE_REHASH_INCREMENTAL,
+    /** The call that triggers the resize moves every entry before returning. */
+    HASH_TABLE_REHASH_BLOCKING
+} hash_table_rehash_mode_t;
+
 /**
  * @brief Pointer to a function that computes the hash for an entry.
  * @param entry Pointer to user data.
@@ -33,10 +55,52 @@ typedef bool (*hash_table_compare_func)(void *entry1, void *entry2);
  */
 typedef void (*hash_table_entry_action)(void *entry);
 
+/**
+ * @brief Pointer to a function that visits an entry (for hash_table_foreach_ctx
+ * and hash_table_parallel_foreach).
+ * @param entry Pointer to user data.
+ * @param context The user pointer passed along with the visitor.
+ * @return true to continue, false to stop the walk.
+ */
+typedef bool (*hash_table_entry_visitor)(void *entry, void *context);
+
+/**
+ * @brief Pointer to a function that builds the entry for a missing key
+ * (for hash_table_find_or_insert_with).
+ * The returned entry must hash and compare equal to key.
+ * @param key The key that was looked up.
+ * @param context The user pointer passed to hash_table_find_or_insert_with.
+ * @return The new entry, or NULL if it could not be built.
+ */
+typedef void *(*hash_table_entry_factory)(void *key, void *context);
+
+/**
+ * @brief Memory provider for everything a table allocates (the table itself,
+ * bucket or slot arrays and node slabs).
+ * free() receives the size that was passed to alloc() for the same block.
+ */
+typedef struct {
+    void *(*alloc)(size_t size, void *context);
+    void (*free)(void *ptr, size_t size, void *context);
+    void *context;
+} hash_table_allocator_t;
+
+/**
+ * @brief Cursor over the entries of a table, see hash_table_iterator_begin().
+ * Allocated by the caller (usually on the stack); the fields are private.
+ */
+typedef struct {
+    hash_table_t *table;
+    size_t position;
+    int array;
+    void *node;
+} hash_table_iterator_t;
+
 /**
  * @brief Creates a new hash table instance.
  *
- * @param initial_capacity The initial number of buckets.
+ * @param initial_capacity The initial number of buckets, rounded up to a power of two.
+ * The table grows and shrinks on its own; this is also the smallest capacity it shrinks to.
  * @param hash_func The function to compute the hash.
  * @param compare_func The function to compare two entries.
  * @param table A pointer to a pointer where the newly created table will be stored.
@@ -47,6 +111,22 @@ dsa_status_t hash_table_create(unsigned int initial_capacity,
                                hash_table_compare_func compare_func, 
                                hash_table_t **table);
 
+/**
+ * @brief Creates a new hash table instance that takes its memory from allocator.
+ *
+ * @param initial_capacity As for hash_table_create().
+ * @param hash_func The function to compute the hash.
+ * @param compare_func The function to compare two entries.
+ * @param allocator The memory provider, copied into the table; NULL uses malloc/free.
+ * @param table A pointer to a pointer where the newly created table will be stored.
+ * @returns DSA_OK on success, or an error code.
+ */
+dsa_status_t hash_table_create_with_allocator(unsigned int initial_capacity,
+                                              hash_table_hash_func hash_func,
+                                              hash_table_compare_func compare_func,
+                                              const hash_table_allocator_t *allocator,
+                                              hash_table_t **table);
+
 /**
  * @brief Destroys the hash table and frees all associated memory.
  * @note This function does NOT free the memory allocated for user data (entry).
@@ -70,9 +150,57 @@ dsa_status_t hash_table_destroy(hash_table_t *table);
  */
 dsa_status_t hash_table_insert(hash_table_t *table, void *entry);
 
+/**
+ * @brief Inserts entry unless an equal one is stored, hashing and probing once.
+ *
+ * @param table Pointer to the hash table.
+ * @param entry Pointer to the user data to be inserted.
+ * @param existing Receives the entry now stored under this key: entry itself
+ * when it was inserted, otherwise the entry that was already there.
+ * @returns DSA_OK if entry was inserted.
+ * @returns DSA_EXISTS if an equal entry was already stored (entry is not inserted).
+ * @returns DSA_BAD_PARAM if table, entry or existing == NULL.
+ * @returns DSA_ERROR on a memory allocation error.
+ */
+dsa_status_t hash_table_insert_or_get(hash_table_t *table, void *entry, void **existing);
+
+/**
+ * @brief Inserts entry, replacing an equal entry if one is stored.
+ *
+ * @param table Pointer to the hash table.
+ * @param entry Pointer to the user data to be stored.
+ * @param old_entry Receives the replaced entry, or NULL if none was stored.
+ * The table no longer references it; freeing it is up to the caller.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table, entry or old_entry == NULL.
+ * @returns DSA_ERROR on a memory allocation error.
+ */
+dsa_status_t hash_table_upsert(hash_table_t *table, void *entry, void **old_entry);
+
+/**
+ * @brief Looks key up and, if it is missing, inserts the entry built by factory.
+ * factory is only called on a miss, and the key is hashed and probed once either way.
+ *
+ * @param table Pointer to the hash table.
+ * @param key Pointer to the key; uses hash_func and compare_func like an entry.
+ * @param factory Builds the entry to insert from key.
+ * @param context User pointer passed to factory.
+ * @param result Receives the stored entry (found or newly built).
+ * @returns DSA_OK if a new entry was built and inserted.
+ * @returns DSA_EXISTS if an equal entry was already stored.
+ * @returns DSA_BAD_PARAM if table, key, factory or result == NULL.
+ * @returns DSA_ERROR if factory returned NULL (result is NULL) or on a memory
+ * allocation error (result holds the built entry, which was not inserted).
+ */
+dsa_status_t hash_table_find_or_insert_with(hash_table_t *table, void *key,
+                                            hash_table_entry_factory factory, void *context,
+                                            void **result);
+
 /**
  * @brief Removes an entry from the hash table.
- * @note This function only frees the table node, NOT the user data (entry).
+ * @note This function only releases the table node, NOT the user data (entry).
+ * Released nodes are reused by later inserts; their memory goes back to the
+ * allocator in hash_table_destroy().
  * @param table Pointer to the hash table.
  * @param entry Pointer to the entry (or key) to be removed.
  * Uses compare_func for searching.
@@ -93,6 +221,39 @@ dsa_status_t hash_table_remove(hash_table_t *table, void *entry);
  */
 void *hash_table_find(hash_table_t *table, void *entry);
 
+/**
+ * @brief Finds count keys at once; same results as count hash_table_find() calls.
+ * Keys are handled in groups: all keys of a group are hashed and their
+ * buckets prefetched before the first one is resolved, so the cache misses of
+ * the group overlap instead of being paid one after another.
+ *
+ * @param table Pointer to the hash table.
+ * @param keys Array of count entries (or keys), none of them NULL.
+ * @param count Number of keys.
+ * @param results Array of count pointers; results[i] receives the entry found
+ * for keys[i], or NULL.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table, keys or results == NULL, or a key is NULL.
+ */
+dsa_status_t hash_table_find_batch(hash_table_t *table, void **keys, size_t count, void **results);
+
+/**
+ * @brief Inserts count entries at once, prefetching like hash_table_find_batch().
+ * Entries are inserted in array order, so of two equal entries in the batch
+ * the first one wins.
+ *
+ * @param table Pointer to the hash table.
+ * @param entries Array of count entries, none of them NULL.
+ * @param count Number of entries.
+ * @param statuses Optional array of count results: DSA_OK, DSA_EXISTS or DSA_ERROR,
+ * as hash_table_insert() would have returned for entries[i]. May be NULL.
+ * @returns DSA_OK if every entry was inserted or already present.
+ * @returns DSA_ERROR if at least one entry failed on a memory allocation error.
+ * @returns DSA_BAD_PARAM if table or entries == NULL, or an entry is NULL
+ * (nothing is inserted then).
+ */
+dsa_status_t hash_table_insert_batch(hash_table_t *table, void **entries, size_t count, dsa_status_t *statuses);
+
 /**
  * @brief Executes an action (entry_action) for each entry in the table.
  *
@@ -103,5 +264,103 @@ void *hash_table_find(hash_table_t *table, void *entry);
  */
 dsa_status_t hash_table_foreach(hash_table_t *table, hash_table_entry_action entry_action);
 
+/**
+ * @brief Calls visitor(entry, context) for each entry until it returns false.
+ *
+ * @param table Pointer to the hash table.
+ * @param visitor The function that will be called for each entry.
+ * @param context User pointer handed to every visitor call.
+ * @returns DSA_OK on success, also when the visitor stopped the walk early.
+ * @returns DSA_BAD_PARAM if table or visitor == NULL.
+ */
+dsa_status_t hash_table_foreach_ctx(hash_table_t *table, hash_table_entry_visitor visitor, void *context);
+
+/**
+ * @brief Calls visitor(entry, context) for each entry from `threads` threads,
+ * each walking its own range of buckets (or slots). Returns when all are done.
+ * @note The visitor runs concurrently and must be thread-safe; the table must
+ * not be modified until this returns. A visitor returning false stops every
+ * thread at its next bucket.
+ *
+ * @param table Pointer to the hash table.
+ * @param visitor The function that will be called for each entry.
+ * @param context User pointer handed to every visitor call.
+ * @param threads Number of threads to use, 1 walks on the calling thread.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table or visitor == NULL, or threads == 0.
+ * @returns DSA_ERROR if a thread could not be started (nothing was visited by it;
+ * the ranges of started threads were walked).
+ */
+dsa_status_t hash_table_parallel_foreach(hash_table_t *table, hash_table_entry_visitor visitor, void *context,
+                                         unsigned int threads);
+
+/**
+ * @brief Starts an iteration over all entries, returned by hash_table_iterator_next().
+ * While any iterator is open the table does not resize, so removing the entry
+ * just returned by the iterator is safe and no entry is returned twice.
+ * @note Inserting, or changing the load factors, while an iterator is open is
+ * not supported. Every begin must be paired with hash_table_iterator_end().
+ *
+ * @param table Pointer to the hash table.
+ * @param iterator Caller-provided iterator to initialise.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table or iterator == NULL.
+ */
+dsa_status_t hash_table_iterator_begin(hash_table_t *table, hash_table_iterator_t *iterator);
+
+/**
+ * @brief Advances the iterator.
+ *
+ * @param iterator An iterator started by hash_table_iterator_begin().
+ * @returns The next entry, or NULL once every entry has been returned.
+ */
+void *hash_table_iterator_next(hash_table_iterator_t *iterator);
+
+/**
+ * @brief Ends an iteration. Resizes held back while iterators were open
+ * happen when the last one ends.
+ *
+ * @param iterator An iterator started by hash_table_iterator_begin().
+ */
+void hash_table_iterator_end(hash_table_iterator_t *iterator);
+
+
+/**
+ * @brief Returns the number of entries stored in the table.
+ *
+ * @param table Pointer to the hash table.
+ * @returns The number of entries, or 0 if table == NULL.
+ */
+size_t hash_table_size(hash_table_t *table);
+
+/**
+ * @brief Sets the load factors that drive automatic resizing.
+ * The table doubles when size > capacity * max_load_factor and halves when
+ * size < capacity * min_load_factor. If the current size is already outside
+ * the new bounds, the table is resized immediately.
+ *
+ * @param table Pointer to the hash table.
+ * @param max_load_factor Grow threshold, must be > 0.
+ * @param min_load_factor Shrink threshold, must be >= 0 and < max_load_factor / 2.
+ * 0 disables shrinking.
+ * @note With ENGINE=swiss the load factor is the fraction of used slots and
+ * max_load_factor is capped at 0.875.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table == NULL or the factors are out of range.
+ */
+dsa_status_t hash_table_set_load_factors(hash_table_t *table, float max_load_factor, float min_load_factor);
+
+/**
+ * @brief Selects how resizes are carried out.
+ * Switching to HASH_TABLE_REHASH_BLOCKING finishes a rehash that is in progress.
+ *
+ * @param table Pointer to the hash table.
+ * @param mode HASH_TABLE_REHASH_INCREMENTAL or HASH_TABLE_REHASH_BLOCKING.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table == NULL, mode is unknown or the engine cannot
+ * honour it (ENGINE=swiss only supports HASH_TABLE_REHASH_BLOCKING).
+ */
+dsa_status_t hash_table_set_rehash_mode(hash_table_t *table, hash_table_rehash_mode_t mode);
+
 
 #endif // HASH_TABLE_H
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef HASH_TABLE_CONCURRENT_H
+#define HASH_TABLE_CONCURRENT_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "status.h"
+#include "hash_table.h"
+
+/**
+ * @brief Opaque declaration of the thread-safe hash table.
+ * The table is split into independent segments, each guarded by its own
+ * reader-writer lock and resized on its own, so threads working on different
+ * segments never wait for each other. It uses the same callbacks as hash_table_t.
+ */
+typedef struct hash_table_concurrent hash_table_concurrent_t;
+
+/**
+ * @brief Number of segments (lock stripes) of every concurrent table.
+ */
+#define HASH_TABLE_CONCURRENT_SEGMENTS 64
+
+/**
+ * @brief How readers are synchronized with writers.
+ * LOCKED: find and foreach take the segment's read lock.
+ * READ_MOSTLY: find and foreach take no lock and never wait; writers still
+ * lock their segment. Removed nodes and replaced bucket arrays are freed only
+ * after every reader that could still see them has left (epoch-based
+ * reclamation), which makes writes more expensive.
+ */
+typedef enum {
+    HASH_TABLE_CONCURRENT_LOCKED,
+    HASH_TABLE_CONCURRENT_READ_MOSTLY
+} hash_table_concurrent_mode_t;
+
+/**
+ * @brief Creates a new thread-safe hash table.
+ *
+ * @param initial_capacity The initial total number of buckets, spread over the segments.
+ * @param hash_func The function to compute the hash.
+ * @param compare_func The function to compare two entries.
+ * @param table A pointer to a pointer where the newly created table will be stored.
+ * @returns DSA_OK on success, or an error code.
+ */
+dsa_status_t hash_table_concurrent_create(unsigned int initial_capacity,
+                                          hash_table_hash_func hash_func,
+                                          hash_table_compare_func compare_func,
+                                          hash_table_concurrent_t **table);
+
+/**
+ * @brief Creates a new thread-safe hash table with the given reader mode.
+ * hash_table_concurrent_create() is this with HASH_TABLE_CONCURRENT_LOCKED.
+ *
+ * @param initial_capacity The initial total number of buckets, spread over the segments.
+ * @param hash_func The function to compute the hash.
+ * @param compare_func The function to compare two entries.
+ * @param mode HASH_TABLE_CONCURRENT_LOCKED or HASH_TABLE_CONCURRENT_READ_MOSTLY.
+ * @param table A pointer to a pointer where the newly created table will be stored.
+ * @returns DSA_OK on success, or an error code.
+ */
+dsa_status_t hash_table_concurrent_create_with_mode(unsigned int initial_capacity,
+                                                    hash_table_hash_func hash_func,
+                                                    hash_table_compare_func compare_func,
+                                                    hash_table_concurrent_mode_t mode,
+                                                    hash_table_concurrent_t **table);
+
+/**
+ * @brief Destroys the table. No other thread may use it any more.
+ * @note As with hash_table_destroy(), user data is NOT freed.
+ *
+ * @param table Pointer to the hash table to be destroyed.
+ * @returns DSA_OK on success, or DSA_BAD_PARAM if table == NULL.
+ */
+dsa_status_t hash_table_concurrent_destroy(hash_table_concurrent_t *table);
+
+/**
+ * @brief Inserts a new entry. Safe to call from any thread.
+ *
+ * @param table Pointer to the hash table.
+ * @param entry Pointer to the user data to be inserted.
+ * @returns DSA_OK on successful insertion.
+ * @returns DSA_EXISTS if such an element already exists.
+ * @returns DSA_BAD_PARAM if table or entry == NULL.
+ * @returns DSA_ERROR on a memory allocation error.
+ */
+dsa_status_t hash_table_concurrent_insert(hash_table_concurrent_t *table, void *entry);
+
+/**
+ * @brief Removes an entry. Safe to call from any thread.
+ * @note Only the table node is freed, NOT the user data (entry).
+ *
+ * @param table Pointer to the hash table.
+ * @param entry Pointer to the entry (or key) to be removed.
+ * @returns DSA_OK on successful removal.
+ * @returns DSA_NOT_FOUND if the element is not found.
+ * @returns DSA_BAD_PARAM if table or entry == NULL.
+ */
+dsa_status_t hash_table_concurrent_remove(hash_table_concurrent_t *table, void *entry);
+
+/**
+ * @brief Finds an entry. Safe to call from any thread; lookups in the same
+ * segment run in parallel, and in READ_MOSTLY mode take no lock at all.
+ * @note The returned entry may be removed by another thread right after;
+ * keeping it alive is up to the caller.
+ *
+ * @param table Pointer to the hash table.
+ * @param entry Pointer to the entry (or key) to be found.
+ * @returns A pointer to the found entry, or NULL if not found or on error.
+ */
+void *hash_table_concurrent_find(hash_table_concurrent_t *table, void *entry);
+
+/**
+ * @brief Executes entry_action for each entry, one segment at a time under
+ * that segment's read lock (LOCKED) or without locking (READ_MOSTLY).
+ * @note entry_action must not insert into or remove from the same table.
+ * Entries changed by other threads during the walk may or may not be visited.
+ *
+ * @param table Pointer to the hash table.
+ * @param entry_action The function that will be called for each entry.
+ * @returns DSA_OK on success.
+ * @returns DSA_BAD_PARAM if table or entry_action == NULL.
+ */
+dsa_status_t hash_table_concurrent_foreach(hash_table_concurrent_t *table, hash_table_entry_action entry_action);
+
+/**
+ * @brief Returns the number of entries; a snapshot while other threads write.
+ *
+ * @param table Pointer to the hash table.
+ * @returns The number of entries, or 0 if table == NULL.
+ */
+size_t hash_table_concurrent_size(hash_table_concurrent_t *table);
+
+
+#endif // HASH_TABLE_CONCURRENT_H
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 
 #define INITIAL_CAPACITY 16
+#define BULK_ENTRIES 100000
+#define SCAN_THREADS 4
 
 /** USAGE **/
 typedef struct {
@@ -30,6 +32,18 @@ void my_data_action(void *entry) {
     printf("Foreach action: aaa = %f\n", data->some_huge_struct.aaa);
 }
 
+bool count_b_zero(void *entry, void *context) {
+    if (((some_data_t *)entry)->b == 0) {
+        __atomic_fetch_add((long *)context, 1, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+bool take_first(void *entry, void *context) {
+    *(some_data_t **)context = entry;
+    return false;
+}
+
 int main() {
     hash_table_t *table = NULL;
 
@@ -95,6 +109,44 @@ int main() {
     free(data);
     printf("Freed user data.\n");
 
+    /* Resize */
+    some_data_t *bulk = calloc(BULK_ENTRIES, sizeof(some_data_t));
+    if (!bulk) {
+        hash_table_destroy(table);
+        return 1;
+    }
+    for (int i = 0; i < BULK_ENTRIES; i++) {
+        bulk[i].a = i;
+        bulk[i].b = i % 7;
+        hash_table_insert(table, &bulk[i]);
+    }
+    printf("Inserted %d entries, size = %zu\n", BULK_ENTRIES, hash_table_size(table));
+
+    /* Scan */
+    long matches = 0;
+    hash_table_parallel_foreach(table, count_b_zero, &matches, SCAN_THREADS);
+    printf("Parallel scan with %d threads: %ld entries with b == 0\n", SCAN_THREADS, matches);
+
+    some_data_t *first = NULL;
+    hash_table_foreach_ctx(table, take_first, &first);
+    printf("First entry visited: a = %d\n", first ? first->a : -1);
+
+    hash_table_iterator_t iterator;
+    hash_table_iterator_begin(table, &iterator);
+    for (some_data_t *entry; (entry = hash_table_iterator_next(&iterator)) != NULL;) {
+        if (entry->b == 0) {
+            hash_table_remove(table, entry);
+        }
+    }
+    hash_table_iterator_end(&iterator);
+    printf("Removed entries with b == 0 while iterating, size = %zu\n", hash_table_size(table));
+
+    for (int i = 0; i < BULK_ENTRIES; i++) {
+        hash_table_remove(table, &bulk[i]);
+    }
+    printf("Removed them again, size = %zu\n", hash_table_size(table));
+    free(bulk);
+
     /* Destroy table */
     hash_table_destroy(table);
     printf("Hash table destroyed.\n");
@@ -1,111 +1,516 @@
 #include "hash_table.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 
+/* hash is the mixed hash of entry: chain walks compare it before calling
+ * compare_func, and rehashing reuses it instead of calling hash_func. */
 typedef struct hash_table_node
 {
     void *entry;
     struct hash_table_node *next;
+    unsigned int hash;
 } hash_table_node_t;
 
+#define HASH_TABLE_MAX_CAPACITY (1u << 31)
+
+/* Nodes are carved from slabs that double in size up to the maximum. */
+#define HASH_TABLE_SLAB_MIN_NODES 64
+#define HASH_TABLE_SLAB_MAX_NODES 65536
+
+typedef struct hash_table_slab
+{
+    struct hash_table_slab *next;
+    size_t nodes;
+    hash_table_node_t node[];
+} hash_table_slab_t;
+
+/* Buckets migrated per insert/find/remove while an incremental rehash runs,
+ * and how many empty old buckets one step may skip over per migrated bucket. */
+#define HASH_TABLE_REHASH_STEP 1
+#define HASH_TABLE_REHASH_EMPTY_VISITS 10
+
+/* Keys hashed and prefetched ahead by the batch functions: enough misses in
+ * flight to cover memory latency, few enough that the lines are still cached
+ * when the group is resolved. */
+#define HASH_TABLE_BATCH 16
+
+/*
+ * During a resize both bucket arrays are live: buckets[0] is drained into
+ * buckets[1] from rehash_index upwards, and everything below rehash_index is
+ * already empty. When the old array is drained, buckets[1] becomes buckets[0].
+ * While iterators are open, nodes stay where they are: no resize starts and a
+ * running rehash does not advance.
+ */
 struct hash_table
 {
-    unsigned int capacity;
+    unsigned int capacity[2];
+    unsigned int min_capacity;
+    long rehash_index;
+    hash_table_rehash_mode_t rehash_mode;
+    size_t count;
+    float max_load_factor;
+    float min_load_factor;
     hash_table_hash_func hash_func;
     hash_table_compare_func compare_func;
-    hash_table_node_t **buckets;
+    hash_table_node_t **buckets[2];
+    hash_table_allocator_t allocator;
+    hash_table_slab_t *slabs;
+    size_t slab_used;
+    hash_table_node_t *free_nodes;
+    unsigned int iterators;
 };
 
 
-static unsigned int _hash_table_get_index(hash_table_t *table, void *entry) {
-    return (unsigned int)table->hash_func(entry) % table->capacity;
+/* Capacity is a power of two, so the user hash is mixed (murmur3 finalizer)
+ * before masking: otherwise only its low bits would pick the bucket. */
+static unsigned int _hash_table_mix(int hash) {
+    unsigned int h = (unsigned int)hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static void *_hash_table_default_alloc(size_t size, void *context) {
+    (void)context;
+    return malloc(size);
+}
+
+static void _hash_table_default_free(void *ptr, size_t size, void *context) {
+    (void)size;
+    (void)context;
+    free(ptr);
+}
+
+static const hash_table_allocator_t _hash_table_default_allocator = {
+    _hash_table_default_alloc, _hash_table_default_free, NULL
+};
+
+/* Bucket arrays: calloc for the default allocator, so a large array is backed
+ * by fresh zero pages instead of being cleared up front. */
+static void *_hash_table_alloc_buckets(hash_table_t *table, unsigned int capacity) {
+    if (table->allocator.alloc == _hash_table_default_alloc) {
+        return calloc(capacity, sizeof(hash_table_node_t *));
+    }
+    void *buckets = table->allocator.alloc((size_t)capacity * sizeof(hash_table_node_t *), table->allocator.context);
+    if (buckets) {
+        memset(buckets, 0, (size_t)capacity * sizeof(hash_table_node_t *));
+    }
+    return buckets;
+}
+
+static void _hash_table_free_buckets(hash_table_t *table, hash_table_node_t **buckets, unsigned int capacity) {
+    if (buckets) {
+        table->allocator.free(buckets, (size_t)capacity * sizeof(hash_table_node_t *), table->allocator.context);
+    }
+}
+
+/* Reuses a node freed by remove, else takes the next one from the newest slab. */
+static hash_table_node_t *_hash_table_alloc_node(hash_table_t *table) {
+    hash_table_node_t *node = table->free_nodes;
+    if (node) {
+        table->free_nodes = node->next;
+        return node;
+    }
+
+    if (!table->slabs || table->slab_used == table->slabs->nodes) {
+        size_t nodes = table->slabs ? table->slabs->nodes * 2 : HASH_TABLE_SLAB_MIN_NODES;
+        if (nodes > HASH_TABLE_SLAB_MAX_NODES) {
+            nodes = HASH_TABLE_SLAB_MAX_NODES;
+        }
+        hash_table_slab_t *slab = table->allocator.alloc(sizeof(hash_table_slab_t) + nodes * sizeof(hash_table_node_t),
+                                                         table->allocator.context);
+        if (!slab) {
+            return NULL;
+        }
+        slab->nodes = nodes;
+        slab->next = table->slabs;
+        table->slabs = slab;
+        table->slab_used = 0;
+    }
+    return &table->slabs->node[table->slab_used++];
+}
+
+static void _hash_table_free_node(hash_table_t *table, hash_table_node_t *node) {
+    node->next = table->free_nodes;
+    table->free_nodes = node;
+}
+
+static bool _hash_table_is_rehashing(hash_table_t *table) {
+    return table->rehash_index >= 0;
+}
+
+static unsigned int _hash_table_round_capacity(unsigned int capacity) {
+    unsigned int rounded = 1;
+    while (rounded < capacity && rounded < HASH_TABLE_MAX_CAPACITY) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/* Migrates up to `buckets` non-empty old buckets. Returns true while the
+ * rehash is still in progress. */
+static bool _hash_table_rehash_step(hash_table_t *table, unsigned int buckets) {
+    unsigned int empty_visits = buckets * HASH_TABLE_REHASH_EMPTY_VISITS;
+
+    while (buckets > 0 && (unsigned long)table->rehash_index < table->capacity[0]) {
+        hash_table_node_t *current = table->buckets[0][table->rehash_index];
+        if (current == NULL) {
+            table->rehash_index++;
+            if (--empty_visits == 0) {
+                return true;
+            }
+            continue;
+        }
+
+        while (current != NULL) {
+            hash_table_node_t *next = current->next;
+            unsigned int index = current->hash & (table->capacity[1] - 1);
+            current->next = table->buckets[1][index];
+            table->buckets[1][index] = current;
+            current = next;
+        }
+        table->buckets[0][table->rehash_index++] = NULL;
+        buckets--;
+    }
+
+    if ((unsigned long)table->rehash_index < table->capacity[0]) {
+        return true;
+    }
+
+    _hash_table_free_buckets(table, table->buckets[0], table->capacity[0]);
+    table->buckets[0] = table->buckets[1];
+    table->capacity[0] = table->capacity[1];
+    table->buckets[1] = NULL;
+    table->capacity[1] = 0;
+    table->rehash_index = -1;
+    return false;
+}
+
+/* Starts moving the table to new_capacity buckets; in blocking mode the move
+ * also completes here. On allocation failure the table keeps its current
+ * buckets: it stays correct, only the chains get longer. */
+static dsa_status_t _hash_table_resize(hash_table_t *table, unsigned int new_capacity) {
+    hash_table_node_t **new_buckets = _hash_table_alloc_buckets(table, new_capacity);
+    if (!new_buckets) {
+        return DSA_ERROR;
+    }
+
+    table->buckets[1] = new_buckets;
+    table->capacity[1] = new_capacity;
+    table->rehash_index = 0;
+
+    if (table->rehash_mode == HASH_TABLE_REHASH_BLOCKING) {
+        while (_hash_table_rehash_step(table, table->capacity[0])) {
+        }
+    }
+    return DSA_OK;
+}
+
+/* A resize already in flight is finished first: the load is judged against
+ * the array that will remain. */
+static void _hash_table_grow_if_needed(hash_table_t *table) {
+    while (!_hash_table_is_rehashing(table) && table->iterators == 0 && table->capacity[0] < HASH_TABLE_MAX_CAPACITY &&
+           table->count > (size_t)(table->capacity[0] * table->max_load_factor)) {
+        if (_hash_table_resize(table, table->capacity[0] << 1) != DSA_OK) {
+            break;
+        }
+    }
+}
+
+static void _hash_table_shrink_if_needed(hash_table_t *table) {
+    while (!_hash_table_is_rehashing(table) && table->iterators == 0 && table->capacity[0] > table->min_capacity &&
+           table->count < (size_t)(table->capacity[0] * table->min_load_factor)) {
+        if (_hash_table_resize(table, table->capacity[0] >> 1) != DSA_OK) {
+            break;
+        }
+    }
+}
+
+/* Finds the link that points at the node holding entry, in whichever array
+ * holds it, or NULL. */
+static hash_table_node_t **_hash_table_find_link(hash_table_t *table, unsigned int hash, void *entry) {
+    for (int i = 0; i <= (_hash_table_is_rehashing(table) ? 1 : 0); i++) {
+        hash_table_node_t **link = &table->buckets[i][hash & (table->capacity[i] - 1)];
+        while (*link != NULL) {
+            if ((*link)->hash == hash && table->compare_func((*link)->entry, entry)) {
+                return link;
+            }
+            link = &(*link)->next;
+        }
+    }
+
+    return NULL;
 }
 
 dsa_status_t hash_table_create(unsigned int initial_capacity,hash_table_hash_func hash_func,hash_table_compare_func compare_func,hash_table_t **table) {
-    if (initial_capacity == 0 || !hash_func || !compare_func || !table) {
+    return hash_table_create_with_allocator(initial_capacity, hash_func, compare_func, NULL, table);
+}
+
+dsa_status_t hash_table_create_with_allocator(unsigned int initial_capacity,
+                                              hash_table_hash_func hash_func,
+                                              hash_table_compare_func compare_func,
+                                              const hash_table_allocator_t *allocator,
+                                              hash_table_t **table) {
+    if (initial_capacity == 0 || !hash_func || !compare_func || !table ||
+        (allocator && (!allocator->alloc || !allocator->free))) {
         return DSA_BAD_PARAM;
     }
+    if (!allocator) {
+        allocator = &_hash_table_default_allocator;
+    }
 
-    hash_table_t *new_table = malloc(sizeof(hash_table_t));
+    hash_table_t *new_table = allocator->alloc(sizeof(hash_table_t), allocator->context);
     if (!new_table) {
         return DSA_ERROR;
     }
+    new_table->allocator = *allocator;
 
-    new_table->buckets = calloc(initial_capacity, sizeof(hash_table_node_t *));
-    if (!new_table->buckets) {
-        free(new_table);
+    initial_capacity = _hash_table_round_capacity(initial_capacity);
+    new_table->buckets[0] = _hash_table_alloc_buckets(new_table, initial_capacity);
+    if (!new_table->buckets[0]) {
+        allocator->free(new_table, sizeof(hash_table_t), allocator->context);
         return DSA_ERROR;
     }
 
-    new_table->capacity = initial_capacity;
+    new_table->buckets[1] = NULL;
+    new_table->capacity[0] = initial_capacity;
+    new_table->capacity[1] = 0;
+    new_table->min_capacity = initial_capacity;
+    new_table->rehash_index = -1;
+    new_table->rehash_mode = HASH_TABLE_REHASH_INCREMENTAL;
+    new_table->count = 0;
+    new_table->max_load_factor = HASH_TABLE_DEFAULT_MAX_LOAD_FACTOR;
+    new_table->min_load_factor = HASH_TABLE_DEFAULT_MIN_LOAD_FACTOR;
     new_table->hash_func = hash_func;
     new_table->compare_func = compare_func;
+    new_table->slabs = NULL;
+    new_table->slab_used = 0;
+    new_table->free_nodes = NULL;
+    new_table->iterators = 0;
 
     *table = new_table;
     return DSA_OK;
 }
 
+/* Nodes are never freed one by one: releasing the slabs releases them all. */
 dsa_status_t hash_table_destroy(hash_table_t *table) {
     if (!table) {
         return DSA_BAD_PARAM;
     }
 
-    for (unsigned int i = 0; i < table->capacity; i++) {
-        hash_table_node_t *current = table->buckets[i];
+    hash_table_slab_t *slab = table->slabs;
+    while (slab != NULL) {
+        hash_table_slab_t *to_free = slab;
+        slab = slab->next;
+        table->allocator.free(to_free, sizeof(hash_table_slab_t) + to_free->nodes * sizeof(hash_table_node_t),
+                              table->allocator.context);
+    }
 
-        while (current != NULL) {
-            hash_table_node_t *to_free = current;
-            current = current->next;
-            free(to_free);
-        }
+    for (int b = 0; b < 2; b++) {
+        _hash_table_free_buckets(table, table->buckets[b], table->capacity[b]);
     }
 
-    free(table->buckets);
-    free(table);
+    hash_table_allocator_t allocator = table->allocator;
+    allocator.free(table, sizeof(hash_table_t), allocator.context);
 
     return DSA_OK;
 }
 
-dsa_status_t hash_table_insert(hash_table_t *table, void *entry) {
-    if (!table || !entry) {
-        return DSA_BAD_PARAM;
+/* Advances a running rehash and walks the chain(s) of an already mixed hash. */
+static hash_table_node_t **_hash_table_probe_hashed(hash_table_t *table, unsigned int hash, void *entry) {
+    if (_hash_table_is_rehashing(table) && table->iterators == 0) {
+        _hash_table_rehash_step(table, HASH_TABLE_REHASH_STEP);
     }
 
-    if (hash_table_find(table, entry) != NULL) {
-        return DSA_EXISTS;
-    }
+    return _hash_table_find_link(table, hash, entry);
+}
+
+/* Advances a running rehash, hashes entry once and walks its chain(s) once.
+ * Returns the link to the matching node or NULL; *hash receives the hash so
+ * a following _hash_table_link_new() does not compute it again. */
+static hash_table_node_t **_hash_table_probe(hash_table_t *table, void *entry, unsigned int *hash) {
+    *hash = _hash_table_mix(table->hash_func(entry));
+    return _hash_table_probe_hashed(table, *hash, entry);
+}
 
-    unsigned int index = _hash_table_get_index(table, entry);
+/* Links entry at the head of its bucket; must follow a _hash_table_probe()
+ * that found no match. New entries go to the array that survives the rehash. */
+static dsa_status_t _hash_table_link_new(hash_table_t *table, unsigned int hash, void *entry) {
+    int b = _hash_table_is_rehashing(table) ? 1 : 0;
+    unsigned int index = hash & (table->capacity[b] - 1);
 
-    hash_table_node_t *new_node = malloc(sizeof(hash_table_node_t));
+    hash_table_node_t *new_node = _hash_table_alloc_node(table);
     if (!new_node) {
         return DSA_ERROR;
     }
     new_node->entry = entry;
+    new_node->hash = hash;
 
-    new_node->next = table->buckets[index];
-    table->buckets[index] = new_node;
+    new_node->next = table->buckets[b][index];
+    table->buckets[b][index] = new_node;
+    table->count++;
 
+    _hash_table_grow_if_needed(table);
     return DSA_OK;
 }
 
+dsa_status_t hash_table_insert(hash_table_t *table, void *entry) {
+    void *existing;
+    return hash_table_insert_or_get(table, entry, &existing);
+}
+
+dsa_status_t hash_table_insert_or_get(hash_table_t *table, void *entry, void **existing) {
+    if (!table || !entry || !existing) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash;
+    hash_table_node_t **link = _hash_table_probe(table, entry, &hash);
+    if (link != NULL) {
+        *existing = (*link)->entry;
+        return DSA_EXISTS;
+    }
+
+    *existing = entry;
+    return _hash_table_link_new(table, hash, entry);
+}
+
+dsa_status_t hash_table_upsert(hash_table_t *table, void *entry, void **old_entry) {
+    if (!table || !entry || !old_entry) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash;
+    hash_table_node_t **link = _hash_table_probe(table, entry, &hash);
+    if (link != NULL) {
+        *old_entry = (*link)->entry;
+        (*link)->entry = entry;
+        return DSA_OK;
+    }
+
+    *old_entry = NULL;
+    return _hash_table_link_new(table, hash, entry);
+}
+
+dsa_status_t hash_table_find_or_insert_with(hash_table_t *table, void *key,
+                                            hash_table_entry_factory factory, void *context,
+                                            void **result) {
+    if (!table || !key || !factory || !result) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash;
+    hash_table_node_t **link = _hash_table_probe(table, key, &hash);
+    if (link != NULL) {
+        *result = (*link)->entry;
+        return DSA_EXISTS;
+    }
+
+    *result = factory(key, context);
+    if (!*result) {
+        return DSA_ERROR;
+    }
+    return _hash_table_link_new(table, hash, *result);
+}
+
 void *hash_table_find(hash_table_t *table, void *entry) {
     if (!table || !entry) {
         return NULL;
     }
 
-    unsigned int index = _hash_table_get_index(table, entry);
+    unsigned int hash;
+    hash_table_node_t **link = _hash_table_probe(table, entry, &hash);
+    return link ? (*link)->entry : NULL;
+}
 
-    hash_table_node_t *current = table->buckets[index];
-    while (current != NULL) {
-        if (table->compare_func(current->entry, entry)) {
-            return current->entry;
+/* Hashes a group of keys and issues the loads of their lookups one stage at a
+ * time (bucket slots, first nodes, first entries) so that the misses of the
+ * whole group are in flight together. Only prefetches: a stage whose line has
+ * not arrived yet still reads correct data, just slower. */
+static void _hash_table_prefetch_group(hash_table_t *table, void **keys, size_t n, unsigned int *hashes) {
+    int arrays = _hash_table_is_rehashing(table) ? 2 : 1;
+
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = _hash_table_mix(table->hash_func(keys[i]));
+        for (int b = 0; b < arrays; b++) {
+            __builtin_prefetch(&table->buckets[b][hashes[i] & (table->capacity[b] - 1)]);
         }
-        current = current->next;
     }
+    for (size_t i = 0; i < n; i++) {
+        for (int b = 0; b < arrays; b++) {
+            hash_table_node_t *head = table->buckets[b][hashes[i] & (table->capacity[b] - 1)];
+            if (head) {
+                __builtin_prefetch(head);
+            }
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (int b = 0; b < arrays; b++) {
+            hash_table_node_t *head = table->buckets[b][hashes[i] & (table->capacity[b] - 1)];
+            if (head && head->hash == hashes[i]) {
+                __builtin_prefetch(head->entry);
+            }
+        }
+    }
+}
 
-    return NULL;
+dsa_status_t hash_table_find_batch(hash_table_t *table, void **keys, size_t count, void **results) {
+    if (!table || !keys || !results) {
+        return DSA_BAD_PARAM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!keys[i]) {
+            return DSA_BAD_PARAM;
+        }
+    }
+
+    unsigned int hashes[HASH_TABLE_BATCH];
+    for (size_t base = 0; base < count; base += HASH_TABLE_BATCH) {
+        size_t n = count - base < HASH_TABLE_BATCH ? count - base : HASH_TABLE_BATCH;
+        _hash_table_prefetch_group(table, keys + base, n, hashes);
+        for (size_t i = 0; i < n; i++) {
+            hash_table_node_t **link = _hash_table_probe_hashed(table, hashes[i], keys[base + i]);
+            results[base + i] = link ? (*link)->entry : NULL;
+        }
+    }
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_insert_batch(hash_table_t *table, void **entries, size_t count, dsa_status_t *statuses) {
+    if (!table || !entries) {
+        return DSA_BAD_PARAM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!entries[i]) {
+            return DSA_BAD_PARAM;
+        }
+    }
+
+    dsa_status_t result = DSA_OK;
+    unsigned int hashes[HASH_TABLE_BATCH];
+    for (size_t base = 0; base < count; base += HASH_TABLE_BATCH) {
+        size_t n = count - base < HASH_TABLE_BATCH ? count - base : HASH_TABLE_BATCH;
+        _hash_table_prefetch_group(table, entries + base, n, hashes);
+        for (size_t i = 0; i < n; i++) {
+            void *entry = entries[base + i];
+            dsa_status_t status = _hash_table_probe_hashed(table, hashes[i], entry) != NULL
+                                      ? DSA_EXISTS
+                                      : _hash_table_link_new(table, hashes[i], entry);
+            if (status == DSA_ERROR) {
+                result = DSA_ERROR;
+            }
+            if (statuses) {
+                statuses[base + i] = status;
+            }
+        }
+    }
+    return result;
 }
 
 dsa_status_t hash_table_remove(hash_table_t *table, void *entry) {
@@ -113,45 +518,207 @@ dsa_status_t hash_table_remove(hash_table_t *table, void *entry) {
         return DSA_BAD_PARAM;
     }
 
-    unsigned int index = _hash_table_get_index(table, entry);
+    unsigned int hash;
+    hash_table_node_t **link = _hash_table_probe(table, entry, &hash);
+    if (link == NULL) {
+        return DSA_NOT_FOUND;
+    }
 
-    hash_table_node_t *current = table->buckets[index];
-    hash_table_node_t *prev = NULL;
+    hash_table_node_t *current = *link;
+    *link = current->next;
 
-    while (current != NULL) {
-        if (table->compare_func(current->entry, entry)) {
-            break;
+    _hash_table_free_node(table, current);
+    table->count--;
+
+    _hash_table_shrink_if_needed(table);
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_foreach(hash_table_t *table, hash_table_entry_action entry_action) {
+    if (!table || !entry_action) {
+        return DSA_BAD_PARAM;
+    }
+
+    for (int b = 0; b < 2; b++) {
+        for (unsigned int i = 0; i < table->capacity[b]; i++) {
+            hash_table_node_t *current = table->buckets[b][i];
+            while (current != NULL) {
+                entry_action(current->entry);
+                current = current->next;
+            }
         }
-        prev = current;
-        current = current->next;
     }
 
-    if (current == NULL) {
-        return DSA_NOT_FOUND;
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_foreach_ctx(hash_table_t *table, hash_table_entry_visitor visitor, void *context) {
+    if (!table || !visitor) {
+        return DSA_BAD_PARAM;
     }
 
-    if (prev == NULL) {
-        table->buckets[index] = current->next;
-    } else {
-        prev->next = current->next;
+    for (int b = 0; b < 2; b++) {
+        for (unsigned int i = 0; i < table->capacity[b]; i++) {
+            for (hash_table_node_t *current = table->buckets[b][i]; current != NULL; current = current->next) {
+                if (!visitor(current->entry, context)) {
+                    return DSA_OK;
+                }
+            }
+        }
     }
 
-    free(current);
     return DSA_OK;
 }
 
-dsa_status_t hash_table_foreach(hash_table_t *table, hash_table_entry_action entry_action) {
-    if (!table || !entry_action) {
+/* One thread's share of a parallel foreach: buckets [first, last) of both
+ * arrays taken as one sequence, buckets[0] then buckets[1]. */
+typedef struct
+{
+    hash_table_t *table;
+    hash_table_entry_visitor visitor;
+    void *context;
+    size_t first;
+    size_t last;
+    int *stop;
+    pthread_t thread;
+    bool started;
+} hash_table_walk_t;
+
+static void *_hash_table_walk_range(void *arg) {
+    hash_table_walk_t *walk = arg;
+    hash_table_t *table = walk->table;
+
+    for (size_t i = walk->first; i < walk->last && !__atomic_load_n(walk->stop, __ATOMIC_RELAXED); i++) {
+        int b = i < table->capacity[0] ? 0 : 1;
+        size_t index = b == 0 ? i : i - table->capacity[0];
+        for (hash_table_node_t *current = table->buckets[b][index]; current != NULL; current = current->next) {
+            if (!walk->visitor(current->entry, walk->context)) {
+                __atomic_store_n(walk->stop, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+dsa_status_t hash_table_parallel_foreach(hash_table_t *table, hash_table_entry_visitor visitor, void *context,
+                                         unsigned int threads) {
+    if (!table || !visitor || threads == 0) {
         return DSA_BAD_PARAM;
     }
 
-    for (unsigned int i = 0; i < table->capacity; i++) {
-        hash_table_node_t *current = table->buckets[i];
-        while (current != NULL) {
-            entry_action(current->entry);
-            current = current->next;
+    size_t buckets = (size_t)table->capacity[0] + table->capacity[1];
+    if (threads > buckets) {
+        threads = (unsigned int)buckets;
+    }
+
+    hash_table_walk_t *walks = table->allocator.alloc(threads * sizeof(hash_table_walk_t), table->allocator.context);
+    if (!walks) {
+        return DSA_ERROR;
+    }
+
+    int stop = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        walks[t] = (hash_table_walk_t){.table = table, .visitor = visitor, .context = context,
+                                       .first = buckets * t / threads, .last = buckets * (t + 1) / threads,
+                                       .stop = &stop};
+        walks[t].started = t > 0 && pthread_create(&walks[t].thread, NULL, _hash_table_walk_range, &walks[t]) == 0;
+    }
+
+    /* The calling thread takes the first range itself. */
+    _hash_table_walk_range(&walks[0]);
+
+    dsa_status_t status = DSA_OK;
+    for (unsigned int t = 1; t < threads; t++) {
+        if (walks[t].started) {
+            pthread_join(walks[t].thread, NULL);
+        } else {
+            status = DSA_ERROR;
+        }
+    }
+    table->allocator.free(walks, threads * sizeof(hash_table_walk_t), table->allocator.context);
+    return status;
+}
+
+dsa_status_t hash_table_iterator_begin(hash_table_t *table, hash_table_iterator_t *iterator) {
+    if (!table || !iterator) {
+        return DSA_BAD_PARAM;
+    }
+
+    table->iterators++;
+    iterator->table = table;
+    iterator->array = 0;
+    iterator->position = 0;
+    iterator->node = NULL;
+    return DSA_OK;
+}
+
+/* iterator->node is the node to return next, taken before the current one is
+ * handed out, so removing the current entry (which recycles its node) does not
+ * disturb the walk. */
+void *hash_table_iterator_next(hash_table_iterator_t *iterator) {
+    hash_table_t *table = iterator->table;
+    hash_table_node_t *node = iterator->node;
+
+    while (node == NULL) {
+        if (iterator->array > 1) {
+            return NULL;
+        }
+        if (iterator->position >= table->capacity[iterator->array]) {
+            iterator->array++;
+            iterator->position = 0;
+            continue;
         }
+        node = table->buckets[iterator->array][iterator->position++];
     }
 
+    iterator->node = node->next;
+    return node->entry;
+}
+
+void hash_table_iterator_end(hash_table_iterator_t *iterator) {
+    hash_table_t *table = iterator->table;
+    if (--table->iterators > 0) {
+        return;
+    }
+
+    if (table->rehash_mode == HASH_TABLE_REHASH_BLOCKING) {
+        while (_hash_table_is_rehashing(table) && _hash_table_rehash_step(table, table->capacity[0])) {
+        }
+    }
+    _hash_table_grow_if_needed(table);
+    _hash_table_shrink_if_needed(table);
+}
+
+size_t hash_table_size(hash_table_t *table) {
+    return table ? table->count : 0;
+}
+
+dsa_status_t hash_table_set_load_factors(hash_table_t *table, float max_load_factor, float min_load_factor) {
+    /* min < max / 2 keeps a shrink from landing right above the grow threshold
+     * (and a grow right below the shrink one), so the table cannot thrash. */
+    if (!table || !(max_load_factor > 0.0f) || !(min_load_factor >= 0.0f) ||
+        !(min_load_factor < max_load_factor / 2)) {
+        return DSA_BAD_PARAM;
+    }
+
+    table->max_load_factor = max_load_factor;
+    table->min_load_factor = min_load_factor;
+
+    _hash_table_grow_if_needed(table);
+    _hash_table_shrink_if_needed(table);
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_set_rehash_mode(hash_table_t *table, hash_table_rehash_mode_t mode) {
+    if (!table || (mode != HASH_TABLE_REHASH_INCREMENTAL && mode != HASH_TABLE_REHASH_BLOCKING)) {
+        return DSA_BAD_PARAM;
+    }
+
+    table->rehash_mode = mode;
+    if (mode == HASH_TABLE_REHASH_BLOCKING && table->iterators == 0) {
+        while (_hash_table_is_rehashing(table) && _hash_table_rehash_step(table, table->capacity[0])) {
+        }
+    }
     return DSA_OK;
-}
\ No newline at end of file
+}
@@ -0,0 +1,525 @@
+#define _POSIX_C_SOURCE 200112L
+#include "hash_table_concurrent.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* retired_next chains nodes waiting for reclamation in read-mostly mode;
+ * next itself must stay intact for readers still walking past the node. */
+typedef struct hash_table_node
+{
+    void *entry;
+    struct hash_table_node *next;
+    struct hash_table_node *retired_next;
+    unsigned int hash;
+} hash_table_node_t;
+
+typedef struct hash_table_buckets
+{
+    struct hash_table_buckets *retired_next;
+    unsigned int capacity;
+    hash_table_node_t *head[];
+} hash_table_buckets_t;
+
+/* The top bits of the mixed hash pick the segment, the low bits the bucket
+ * inside it: 26 == 32 - log2(HASH_TABLE_CONCURRENT_SEGMENTS). */
+#define HASH_TABLE_SEGMENT_SHIFT 26
+#define HASH_TABLE_SEGMENT_MIN_CAPACITY 4
+#define HASH_TABLE_SEGMENT_MAX_CAPACITY (1u << 26)
+#define HASH_TABLE_CACHE_LINE 64
+
+/* Read-mostly mode: nodes a segment may hold back before it reclaims them,
+ * and the number of reader slots (threads beyond that share slots). */
+#define HASH_TABLE_RECLAIM_BATCH 1024
+#define HASH_TABLE_READER_SLOTS 64
+
+/* A segment is a small chained table of its own. Each one sits on its own
+ * cache line(s) so that locking one never invalidates its neighbours. In
+ * read-mostly mode only writers take the lock. */
+typedef struct hash_table_segment
+{
+    pthread_rwlock_t lock;
+    hash_table_buckets_t *buckets;
+    unsigned int min_capacity;
+    size_t count;
+    hash_table_node_t *retired_nodes;
+    hash_table_buckets_t *retired_buckets;
+    size_t retired_count;
+} __attribute__((aligned(HASH_TABLE_CACHE_LINE))) hash_table_segment_t;
+
+/* Readers announce themselves in the counter of the current epoch parity of
+ * their slot; a slot is a cache line, so readers on different slots share nothing. */
+typedef struct hash_table_reader_slot
+{
+    unsigned long active[2];
+} __attribute__((aligned(HASH_TABLE_CACHE_LINE))) hash_table_reader_slot_t;
+
+struct hash_table_concurrent
+{
+    hash_table_hash_func hash_func;
+    hash_table_compare_func compare_func;
+    float max_load_factor;
+    float min_load_factor;
+    hash_table_concurrent_mode_t mode;
+    unsigned long epoch;
+    pthread_mutex_t reclaim_lock;
+    hash_table_segment_t segments[HASH_TABLE_CONCURRENT_SEGMENTS];
+    hash_table_reader_slot_t readers[HASH_TABLE_READER_SLOTS];
+};
+
+static unsigned int _hash_table_next_reader_slot;
+static __thread int _hash_table_reader_slot = -1;
+
+
+/* Same murmur3 finalizer as the single-threaded engines. */
+static unsigned int _hash_table_mix(int hash) {
+    unsigned int h = (unsigned int)hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static hash_table_segment_t *_hash_table_segment(hash_table_concurrent_t *table, unsigned int hash) {
+    return &table->segments[hash >> HASH_TABLE_SEGMENT_SHIFT];
+}
+
+static unsigned int _hash_table_round_capacity(unsigned int capacity) {
+    unsigned int rounded = HASH_TABLE_SEGMENT_MIN_CAPACITY;
+    while (rounded < capacity && rounded < HASH_TABLE_SEGMENT_MAX_CAPACITY) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+static hash_table_buckets_t *_hash_table_alloc_buckets(unsigned int capacity) {
+    hash_table_buckets_t *buckets = calloc(1, sizeof(hash_table_buckets_t) + capacity * sizeof(hash_table_node_t *));
+    if (buckets) {
+        buckets->capacity = capacity;
+    }
+    return buckets;
+}
+
+static hash_table_node_t *_hash_table_load(hash_table_node_t **link) {
+    return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+}
+
+static void _hash_table_store(hash_table_node_t **link, hash_table_node_t *node) {
+    __atomic_store_n(link, node, __ATOMIC_RELEASE);
+}
+
+/** EPOCH RECLAMATION **/
+/* Entering never loops or waits: load the epoch, bump one counter. Returns
+ * the token to pass to _hash_table_reader_exit(). */
+static unsigned long *_hash_table_reader_enter(hash_table_concurrent_t *table) {
+    if (_hash_table_reader_slot < 0) {
+        _hash_table_reader_slot = __atomic_fetch_add(&_hash_table_next_reader_slot, 1, __ATOMIC_RELAXED) %
+                                  HASH_TABLE_READER_SLOTS;
+    }
+    unsigned long parity = __atomic_load_n(&table->epoch, __ATOMIC_RELAXED) & 1;
+    unsigned long *active = &table->readers[_hash_table_reader_slot].active[parity];
+    __atomic_fetch_add(active, 1, __ATOMIC_SEQ_CST);
+    return active;
+}
+
+static void _hash_table_reader_exit(unsigned long *active) {
+    __atomic_fetch_sub(active, 1, __ATOMIC_RELEASE);
+}
+
+/* Returns once every reader that was inside the table when it was called has
+ * left. Both parities are drained in turn: flipping the epoch first sends new
+ * readers to the other counter, so each wait only sees old readers finish. */
+static void _hash_table_synchronize(hash_table_concurrent_t *table) {
+    pthread_mutex_lock(&table->reclaim_lock);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int phase = 0; phase < 2; phase++) {
+        unsigned long parity = __atomic_fetch_add(&table->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+        for (int s = 0; s < HASH_TABLE_READER_SLOTS; s++) {
+            while (__atomic_load_n(&table->readers[s].active[parity], __ATOMIC_ACQUIRE) != 0) {
+                sched_yield();
+            }
+        }
+    }
+    pthread_mutex_unlock(&table->reclaim_lock);
+}
+
+static void _hash_table_free_retired(hash_table_node_t *nodes, hash_table_buckets_t *buckets) {
+    while (nodes != NULL) {
+        hash_table_node_t *to_free = nodes;
+        nodes = nodes->retired_next;
+        free(to_free);
+    }
+    while (buckets != NULL) {
+        hash_table_buckets_t *to_free = buckets;
+        buckets = buckets->retired_next;
+        free(to_free);
+    }
+}
+
+static void _hash_table_retire_node(hash_table_segment_t *segment, hash_table_node_t *node) {
+    node->retired_next = segment->retired_nodes;
+    segment->retired_nodes = node;
+    segment->retired_count++;
+}
+
+/* Called under the segment lock: hands the retired lists over to the caller
+ * once they are worth a grace period, so it can wait without the lock held. */
+static bool _hash_table_take_retired(hash_table_segment_t *segment, hash_table_node_t **nodes,
+                                     hash_table_buckets_t **buckets) {
+    if (segment->retired_count < HASH_TABLE_RECLAIM_BATCH && !segment->retired_buckets) {
+        return false;
+    }
+    *nodes = segment->retired_nodes;
+    *buckets = segment->retired_buckets;
+    segment->retired_nodes = NULL;
+    segment->retired_buckets = NULL;
+    segment->retired_count = 0;
+    return true;
+}
+
+/** RESIZE **/
+/* Locked mode: nobody else is in the segment, so the nodes are relinked. */
+static bool _hash_table_relink(hash_table_segment_t *segment, hash_table_buckets_t *new_buckets) {
+    hash_table_buckets_t *old_buckets = segment->buckets;
+    for (unsigned int i = 0; i < old_buckets->capacity; i++) {
+        hash_table_node_t *current = old_buckets->head[i];
+        while (current != NULL) {
+            hash_table_node_t *next = current->next;
+            unsigned int index = current->hash & (new_buckets->capacity - 1);
+            current->next = new_buckets->head[index];
+            new_buckets->head[index] = current;
+            current = next;
+        }
+    }
+    free(old_buckets);
+    return true;
+}
+
+/* Read-mostly mode: readers may be walking the old chains, and relinking a
+ * node would send them down the wrong one. The chains are copied instead and
+ * the old nodes and array are retired. */
+static bool _hash_table_copy(hash_table_segment_t *segment, hash_table_buckets_t *new_buckets) {
+    hash_table_buckets_t *old_buckets = segment->buckets;
+    for (unsigned int i = 0; i < old_buckets->capacity; i++) {
+        for (hash_table_node_t *current = old_buckets->head[i]; current != NULL; current = current->next) {
+            hash_table_node_t *copy = malloc(sizeof(hash_table_node_t));
+            if (!copy) {
+                hash_table_node_t *copies = NULL;
+                for (unsigned int b = 0; b < new_buckets->capacity; b++) {
+                    for (hash_table_node_t *node = new_buckets->head[b]; node != NULL; node = node->next) {
+                        node->retired_next = copies;
+                        copies = node;
+                    }
+                }
+                _hash_table_free_retired(copies, new_buckets);
+                return false;
+            }
+            unsigned int index = current->hash & (new_buckets->capacity - 1);
+            copy->entry = current->entry;
+            copy->hash = current->hash;
+            copy->next = new_buckets->head[index];
+            new_buckets->head[index] = copy;
+        }
+    }
+
+    for (unsigned int i = 0; i < old_buckets->capacity; i++) {
+        for (hash_table_node_t *current = old_buckets->head[i]; current != NULL; current = current->next) {
+            _hash_table_retire_node(segment, current);
+        }
+    }
+    old_buckets->retired_next = segment->retired_buckets;
+    segment->retired_buckets = old_buckets;
+    return true;
+}
+
+/* Rebuilds the segment with new_capacity buckets; the caller holds the
+ * segment's write lock. On allocation failure the segment keeps its buckets. */
+static void _hash_table_segment_resize(hash_table_concurrent_t *table, hash_table_segment_t *segment,
+                                       unsigned int new_capacity) {
+    hash_table_buckets_t *new_buckets = _hash_table_alloc_buckets(new_capacity);
+    if (!new_buckets) {
+        return;
+    }
+
+    bool moved = table->mode == HASH_TABLE_CONCURRENT_READ_MOSTLY ? _hash_table_copy(segment, new_buckets)
+                                                                   : _hash_table_relink(segment, new_buckets);
+    if (moved) {
+        __atomic_store_n(&segment->buckets, new_buckets, __ATOMIC_RELEASE);
+    }
+}
+
+/* Finds the link that points at the node holding entry, or NULL. For
+ * writers: the link is only stable while the segment lock is held. */
+static hash_table_node_t **_hash_table_find_link(hash_table_concurrent_t *table, hash_table_buckets_t *buckets,
+                                                 unsigned int hash, void *entry) {
+    hash_table_node_t **link = &buckets->head[hash & (buckets->capacity - 1)];
+    while (*link != NULL) {
+        if ((*link)->hash == hash && table->compare_func((*link)->entry, entry)) {
+            return link;
+        }
+        link = &(*link)->next;
+    }
+    return NULL;
+}
+
+/* Finds the node holding entry, or NULL. For readers: every link is loaded
+ * once, with acquire, so a node is seen fully built and a concurrent writer
+ * cannot swap it out between the match and the return. */
+static hash_table_node_t *_hash_table_find_node(hash_table_concurrent_t *table, hash_table_buckets_t *buckets,
+                                                unsigned int hash, void *entry) {
+    hash_table_node_t *current = _hash_table_load(&buckets->head[hash & (buckets->capacity - 1)]);
+    while (current != NULL) {
+        if (current->hash == hash && table->compare_func(current->entry, entry)) {
+            return current;
+        }
+        current = _hash_table_load(&current->next);
+    }
+    return NULL;
+}
+
+dsa_status_t hash_table_concurrent_create(unsigned int initial_capacity,
+                                          hash_table_hash_func hash_func,
+                                          hash_table_compare_func compare_func,
+                                          hash_table_concurrent_t **table) {
+    return hash_table_concurrent_create_with_mode(initial_capacity, hash_func, compare_func,
+                                                  HASH_TABLE_CONCURRENT_LOCKED, table);
+}
+
+dsa_status_t hash_table_concurrent_create_with_mode(unsigned int initial_capacity,
+                                                    hash_table_hash_func hash_func,
+                                                    hash_table_compare_func compare_func,
+                                                    hash_table_concurrent_mode_t mode,
+                                                    hash_table_concurrent_t **table) {
+    if (initial_capacity == 0 || !hash_func || !compare_func || !table ||
+        (mode != HASH_TABLE_CONCURRENT_LOCKED && mode != HASH_TABLE_CONCURRENT_READ_MOSTLY)) {
+        return DSA_BAD_PARAM;
+    }
+
+    void *memory;
+    if (posix_memalign(&memory, HASH_TABLE_CACHE_LINE, sizeof(hash_table_concurrent_t)) != 0) {
+        return DSA_ERROR;
+    }
+    hash_table_concurrent_t *new_table = memory;
+    memset(new_table, 0, sizeof(hash_table_concurrent_t));
+    new_table->hash_func = hash_func;
+    new_table->compare_func = compare_func;
+    new_table->max_load_factor = HASH_TABLE_DEFAULT_MAX_LOAD_FACTOR;
+    new_table->min_load_factor = HASH_TABLE_DEFAULT_MIN_LOAD_FACTOR;
+    new_table->mode = mode;
+    if (pthread_mutex_init(&new_table->reclaim_lock, NULL) != 0) {
+        free(new_table);
+        return DSA_ERROR;
+    }
+
+    unsigned int capacity = _hash_table_round_capacity(initial_capacity / HASH_TABLE_CONCURRENT_SEGMENTS);
+    for (int s = 0; s < HASH_TABLE_CONCURRENT_SEGMENTS; s++) {
+        hash_table_segment_t *segment = &new_table->segments[s];
+        segment->buckets = _hash_table_alloc_buckets(capacity);
+        if (!segment->buckets || pthread_rwlock_init(&segment->lock, NULL) != 0) {
+            free(segment->buckets);
+            while (--s >= 0) {
+                pthread_rwlock_destroy(&new_table->segments[s].lock);
+                free(new_table->segments[s].buckets);
+            }
+            pthread_mutex_destroy(&new_table->reclaim_lock);
+            free(new_table);
+            return DSA_ERROR;
+        }
+        segment->min_capacity = capacity;
+    }
+
+    *table = new_table;
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_concurrent_destroy(hash_table_concurrent_t *table) {
+    if (!table) {
+        return DSA_BAD_PARAM;
+    }
+
+    for (int s = 0; s < HASH_TABLE_CONCURRENT_SEGMENTS; s++) {
+        hash_table_segment_t *segment = &table->segments[s];
+        for (unsigned int i = 0; i < segment->buckets->capacity; i++) {
+            hash_table_node_t *current = segment->buckets->head[i];
+            while (current != NULL) {
+                hash_table_node_t *to_free = current;
+                current = current->next;
+                free(to_free);
+            }
+        }
+        free(segment->buckets);
+        _hash_table_free_retired(segment->retired_nodes, segment->retired_buckets);
+        pthread_rwlock_destroy(&segment->lock);
+    }
+    pthread_mutex_destroy(&table->reclaim_lock);
+    free(table);
+
+    return DSA_OK;
+}
+
+/* The node is allocated before the lock is taken, so the critical section
+ * holds no call into malloc. It is fully built before the release store that
+ * makes it reachable. */
+dsa_status_t hash_table_concurrent_insert(hash_table_concurrent_t *table, void *entry) {
+    if (!table || !entry) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(entry));
+    hash_table_segment_t *segment = _hash_table_segment(table, hash);
+
+    hash_table_node_t *new_node = malloc(sizeof(hash_table_node_t));
+    if (!new_node) {
+        return DSA_ERROR;
+    }
+    new_node->entry = entry;
+    new_node->hash = hash;
+
+    pthread_rwlock_wrlock(&segment->lock);
+    if (_hash_table_find_link(table, segment->buckets, hash, entry) != NULL) {
+        pthread_rwlock_unlock(&segment->lock);
+        free(new_node);
+        return DSA_EXISTS;
+    }
+
+    hash_table_node_t **bucket = &segment->buckets->head[hash & (segment->buckets->capacity - 1)];
+    new_node->next = *bucket;
+    _hash_table_store(bucket, new_node);
+    segment->count++;
+
+    hash_table_node_t *retired_nodes = NULL;
+    hash_table_buckets_t *retired_buckets = NULL;
+    bool reclaim = false;
+    if (segment->buckets->capacity < HASH_TABLE_SEGMENT_MAX_CAPACITY &&
+        segment->count > (size_t)(segment->buckets->capacity * table->max_load_factor)) {
+        _hash_table_segment_resize(table, segment, segment->buckets->capacity << 1);
+        reclaim = _hash_table_take_retired(segment, &retired_nodes, &retired_buckets);
+    }
+    pthread_rwlock_unlock(&segment->lock);
+
+    if (reclaim) {
+        _hash_table_synchronize(table);
+        _hash_table_free_retired(retired_nodes, retired_buckets);
+    }
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_concurrent_remove(hash_table_concurrent_t *table, void *entry) {
+    if (!table || !entry) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(entry));
+    hash_table_segment_t *segment = _hash_table_segment(table, hash);
+
+    pthread_rwlock_wrlock(&segment->lock);
+    hash_table_node_t **link = _hash_table_find_link(table, segment->buckets, hash, entry);
+    if (link == NULL) {
+        pthread_rwlock_unlock(&segment->lock);
+        return DSA_NOT_FOUND;
+    }
+
+    hash_table_node_t *current = *link;
+    _hash_table_store(link, current->next);
+    segment->count--;
+
+    if (segment->buckets->capacity > segment->min_capacity &&
+        segment->count < (size_t)(segment->buckets->capacity * table->min_load_factor)) {
+        _hash_table_segment_resize(table, segment, segment->buckets->capacity >> 1);
+    }
+
+    if (table->mode == HASH_TABLE_CONCURRENT_LOCKED) {
+        pthread_rwlock_unlock(&segment->lock);
+        free(current);
+        return DSA_OK;
+    }
+
+    hash_table_node_t *retired_nodes = NULL;
+    hash_table_buckets_t *retired_buckets = NULL;
+    _hash_table_retire_node(segment, current);
+    bool reclaim = _hash_table_take_retired(segment, &retired_nodes, &retired_buckets);
+    pthread_rwlock_unlock(&segment->lock);
+
+    if (reclaim) {
+        _hash_table_synchronize(table);
+        _hash_table_free_retired(retired_nodes, retired_buckets);
+    }
+    return DSA_OK;
+}
+
+void *hash_table_concurrent_find(hash_table_concurrent_t *table, void *entry) {
+    if (!table || !entry) {
+        return NULL;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(entry));
+    hash_table_segment_t *segment = _hash_table_segment(table, hash);
+
+    if (table->mode == HASH_TABLE_CONCURRENT_READ_MOSTLY) {
+        unsigned long *reader = _hash_table_reader_enter(table);
+        hash_table_buckets_t *buckets = __atomic_load_n(&segment->buckets, __ATOMIC_ACQUIRE);
+        hash_table_node_t *node = _hash_table_find_node(table, buckets, hash, entry);
+        void *found = node ? node->entry : NULL;
+        _hash_table_reader_exit(reader);
+        return found;
+    }
+
+    pthread_rwlock_rdlock(&segment->lock);
+    hash_table_node_t *node = _hash_table_find_node(table, segment->buckets, hash, entry);
+    void *found = node ? node->entry : NULL;
+    pthread_rwlock_unlock(&segment->lock);
+
+    return found;
+}
+
+dsa_status_t hash_table_concurrent_foreach(hash_table_concurrent_t *table, hash_table_entry_action entry_action) {
+    if (!table || !entry_action) {
+        return DSA_BAD_PARAM;
+    }
+
+    for (int s = 0; s < HASH_TABLE_CONCURRENT_SEGMENTS; s++) {
+        hash_table_segment_t *segment = &table->segments[s];
+        unsigned long *reader = NULL;
+        if (table->mode == HASH_TABLE_CONCURRENT_READ_MOSTLY) {
+            reader = _hash_table_reader_enter(table);
+        } else {
+            pthread_rwlock_rdlock(&segment->lock);
+        }
+
+        hash_table_buckets_t *buckets = __atomic_load_n(&segment->buckets, __ATOMIC_ACQUIRE);
+        for (unsigned int i = 0; i < buckets->capacity; i++) {
+            hash_table_node_t *current = _hash_table_load(&buckets->head[i]);
+            while (current != NULL) {
+                entry_action(current->entry);
+                current = _hash_table_load(&current->next);
+            }
+        }
+
+        if (reader) {
+            _hash_table_reader_exit(reader);
+        } else {
+            pthread_rwlock_unlock(&segment->lock);
+        }
+    }
+
+    return DSA_OK;
+}
+
+size_t hash_table_concurrent_size(hash_table_concurrent_t *table) {
+    if (!table) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (int s = 0; s < HASH_TABLE_CONCURRENT_SEGMENTS; s++) {
+        hash_table_segment_t *segment = &table->segments[s];
+        pthread_rwlock_rdlock(&segment->lock);
+        count += segment->count;
+        pthread_rwlock_unlock(&segment->lock);
+    }
+    return count;
+}
@@ -0,0 +1,658 @@
+#include "hash_table.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Open-addressing engine ("Swiss table"). Slots are split into groups of 16;
+ * every slot has one control byte: EMPTY, DELETED or, for a full slot, the low
+ * 7 bits of its hash (h2). The remaining hash bits (h1) pick the first group.
+ * A lookup compares all 16 control bytes of a group at once and only touches
+ * the slots whose h2 matches, so it usually reads one control line and one
+ * slot line. Groups do not overlap; probing moves from group to group with
+ * triangular steps, which visits every group of a power-of-two table.
+ */
+
+#define GROUP_SIZE 16
+#define CTRL_EMPTY ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+/* At most 7/8 of the slots are used (full or tombstone) before a rehash. */
+#define HASH_TABLE_SWISS_MAX_LOAD_FACTOR 0.875f
+#define HASH_TABLE_MAX_CAPACITY (1u << 31)
+
+/* Keys hashed and prefetched ahead by the batch functions. */
+#define HASH_TABLE_BATCH 16
+
+struct hash_table
+{
+    unsigned int capacity;
+    unsigned int min_capacity;
+    size_t count;
+    size_t growth_left;
+    float max_load_factor;
+    float min_load_factor;
+    hash_table_hash_func hash_func;
+    hash_table_compare_func compare_func;
+    int8_t *ctrl;
+    void **slots;
+    hash_table_allocator_t allocator;
+    unsigned int iterators;
+};
+
+typedef uint32_t group_mask_t;
+
+
+static unsigned int _hash_table_mix(int hash) {
+    unsigned int h = (unsigned int)hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+#if defined(__SSE2__)
+
+static group_mask_t _group_match(const int8_t *group, int8_t h2) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static group_mask_t _group_match_empty(const int8_t *group) {
+    return _group_match(group, CTRL_EMPTY);
+}
+
+/* EMPTY and DELETED are the only control values with the sign bit set. */
+static group_mask_t _group_match_empty_or_deleted(const int8_t *group) {
+    return (group_mask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+#else
+
+static group_mask_t _group_match(const int8_t *group, int8_t h2) {
+    group_mask_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        mask |= (group_mask_t)(group[i] == h2) << i;
+    }
+    return mask;
+}
+
+static group_mask_t _group_match_empty(const int8_t *group) {
+    return _group_match(group, CTRL_EMPTY);
+}
+
+static group_mask_t _group_match_empty_or_deleted(const int8_t *group) {
+    group_mask_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        mask |= (group_mask_t)(group[i] < 0) << i;
+    }
+    return mask;
+}
+
+#endif
+
+static void *_hash_table_default_alloc(size_t size, void *context) {
+    (void)context;
+    return malloc(size);
+}
+
+static void _hash_table_default_free(void *ptr, size_t size, void *context) {
+    (void)size;
+    (void)context;
+    free(ptr);
+}
+
+static const hash_table_allocator_t _hash_table_default_allocator = {
+    _hash_table_default_alloc, _hash_table_default_free, NULL
+};
+
+static unsigned int _hash_table_round_capacity(unsigned int capacity) {
+    unsigned int rounded = GROUP_SIZE;
+    while (rounded < capacity && rounded < HASH_TABLE_MAX_CAPACITY) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+static size_t _hash_table_growth_limit(unsigned int capacity, float max_load_factor) {
+    return (size_t)(capacity * max_load_factor);
+}
+
+/* Returns the slot index holding entry, or -1. When free_slot is given it
+ * receives the first EMPTY or DELETED slot seen on the way, where entry
+ * would be inserted, so inserting needs no second probe. */
+static long _hash_table_find_slot(hash_table_t *table, unsigned int hash, void *entry, long *free_slot) {
+    unsigned int group_mask = table->capacity / GROUP_SIZE - 1;
+    unsigned int group = (hash >> 7) & group_mask;
+    int8_t h2 = (int8_t)(hash & 0x7f);
+
+    if (free_slot) {
+        *free_slot = -1;
+    }
+    for (unsigned int step = 1; step <= group_mask + 1; step++) {
+        const int8_t *ctrl = table->ctrl + (size_t)group * GROUP_SIZE;
+        for (group_mask_t match = _group_match(ctrl, h2); match; match &= match - 1) {
+            size_t slot = (size_t)group * GROUP_SIZE + __builtin_ctz(match);
+            if (table->compare_func(table->slots[slot], entry)) {
+                return (long)slot;
+            }
+        }
+        if (free_slot && *free_slot < 0) {
+            group_mask_t free_mask = _group_match_empty_or_deleted(ctrl);
+            if (free_mask) {
+                *free_slot = (long)group * GROUP_SIZE + __builtin_ctz(free_mask);
+            }
+        }
+        if (_group_match_empty(ctrl)) {
+            return -1;
+        }
+        group = (group + step) & group_mask;
+    }
+    return -1;
+}
+
+/* First EMPTY or DELETED slot on the probe sequence of hash. The table is
+ * never completely full, so one always exists. */
+static size_t _hash_table_find_free_slot(hash_table_t *table, unsigned int hash) {
+    unsigned int group_mask = table->capacity / GROUP_SIZE - 1;
+    unsigned int group = (hash >> 7) & group_mask;
+
+    for (unsigned int step = 1;; step++) {
+        group_mask_t free_mask = _group_match_empty_or_deleted(table->ctrl + (size_t)group * GROUP_SIZE);
+        if (free_mask) {
+            return (size_t)group * GROUP_SIZE + __builtin_ctz(free_mask);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+static size_t _hash_table_block_size(unsigned int capacity) {
+    return (size_t)capacity * (1 + sizeof(void *));
+}
+
+static dsa_status_t _hash_table_alloc(hash_table_t *table, unsigned int capacity, int8_t **ctrl, void ***slots) {
+    /* One block: control bytes first, then the slots (capacity is a multiple of 16). */
+    int8_t *block = table->allocator.alloc(_hash_table_block_size(capacity), table->allocator.context);
+    if (!block) {
+        return DSA_ERROR;
+    }
+    memset(block, CTRL_EMPTY, capacity);
+    *ctrl = block;
+    *slots = (void **)(block + capacity);
+    return DSA_OK;
+}
+
+/* Rebuilds the table with new_capacity slots, which also drops every tombstone. */
+static dsa_status_t _hash_table_resize(hash_table_t *table, unsigned int new_capacity) {
+    int8_t *old_ctrl = table->ctrl;
+    void **old_slots = table->slots;
+    unsigned int old_capacity = table->capacity;
+
+    if (_hash_table_alloc(table, new_capacity, &table->ctrl, &table->slots) != DSA_OK) {
+        return DSA_ERROR;
+    }
+    table->capacity = new_capacity;
+
+    for (unsigned int i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] >= 0) {
+            unsigned int hash = _hash_table_mix(table->hash_func(old_slots[i]));
+            size_t slot = _hash_table_find_free_slot(table, hash);
+            table->ctrl[slot] = (int8_t)(hash & 0x7f);
+            table->slots[slot] = old_slots[i];
+        }
+    }
+    table->growth_left = _hash_table_growth_limit(new_capacity, table->max_load_factor) - table->count;
+
+    table->allocator.free(old_ctrl, _hash_table_block_size(old_capacity), table->allocator.context);
+    return DSA_OK;
+}
+
+/* Called when no EMPTY slot may be consumed any more. Mostly tombstones: rebuild
+ * in place at the same size; otherwise double. */
+static dsa_status_t _hash_table_make_room(hash_table_t *table) {
+    size_t limit = _hash_table_growth_limit(table->capacity, table->max_load_factor);
+    if (table->count + 1 <= limit / 2 || table->capacity >= HASH_TABLE_MAX_CAPACITY) {
+        return _hash_table_resize(table, table->capacity);
+    }
+    return _hash_table_resize(table, table->capacity << 1);
+}
+
+/* Open iterators hold slot positions, so removes do not rebuild under them. */
+static void _hash_table_shrink_if_needed(hash_table_t *table) {
+    while (table->iterators == 0 && table->capacity > table->min_capacity &&
+           table->count < (size_t)(table->capacity * table->min_load_factor)) {
+        if (_hash_table_resize(table, table->capacity >> 1) != DSA_OK) {
+            break;
+        }
+    }
+}
+
+dsa_status_t hash_table_create(unsigned int initial_capacity,hash_table_hash_func hash_func,hash_table_compare_func compare_func,hash_table_t **table) {
+    return hash_table_create_with_allocator(initial_capacity, hash_func, compare_func, NULL, table);
+}
+
+dsa_status_t hash_table_create_with_allocator(unsigned int initial_capacity,
+                                              hash_table_hash_func hash_func,
+                                              hash_table_compare_func compare_func,
+                                              const hash_table_allocator_t *allocator,
+                                              hash_table_t **table) {
+    if (initial_capacity == 0 || !hash_func || !compare_func || !table ||
+        (allocator && (!allocator->alloc || !allocator->free))) {
+        return DSA_BAD_PARAM;
+    }
+    if (!allocator) {
+        allocator = &_hash_table_default_allocator;
+    }
+
+    hash_table_t *new_table = allocator->alloc(sizeof(hash_table_t), allocator->context);
+    if (!new_table) {
+        return DSA_ERROR;
+    }
+    new_table->allocator = *allocator;
+
+    initial_capacity = _hash_table_round_capacity(initial_capacity);
+    if (_hash_table_alloc(new_table, initial_capacity, &new_table->ctrl, &new_table->slots) != DSA_OK) {
+        allocator->free(new_table, sizeof(hash_table_t), allocator->context);
+        return DSA_ERROR;
+    }
+
+    new_table->capacity = initial_capacity;
+    new_table->min_capacity = initial_capacity;
+    new_table->count = 0;
+    new_table->max_load_factor = HASH_TABLE_SWISS_MAX_LOAD_FACTOR;
+    new_table->min_load_factor = HASH_TABLE_DEFAULT_MIN_LOAD_FACTOR;
+    new_table->growth_left = _hash_table_growth_limit(initial_capacity, new_table->max_load_factor);
+    new_table->hash_func = hash_func;
+    new_table->compare_func = compare_func;
+    new_table->iterators = 0;
+
+    *table = new_table;
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_destroy(hash_table_t *table) {
+    if (!table) {
+        return DSA_BAD_PARAM;
+    }
+
+    hash_table_allocator_t allocator = table->allocator;
+    allocator.free(table->ctrl, _hash_table_block_size(table->capacity), allocator.context);
+    allocator.free(table, sizeof(hash_table_t), allocator.context);
+
+    return DSA_OK;
+}
+
+/* Stores entry in free_slot, the slot _hash_table_find_slot() reported for
+ * hash. Only when that would consume the last EMPTY slot allowed is the table
+ * rebuilt first, and the slot looked up again. */
+static dsa_status_t _hash_table_place(hash_table_t *table, unsigned int hash, long free_slot, void *entry) {
+    if (table->ctrl[free_slot] == CTRL_EMPTY && table->growth_left == 0) {
+        if (_hash_table_make_room(table) != DSA_OK) {
+            return DSA_ERROR;
+        }
+        free_slot = (long)_hash_table_find_free_slot(table, hash);
+    }
+
+    if (table->ctrl[free_slot] == CTRL_EMPTY) {
+        table->growth_left--;
+    }
+    table->ctrl[free_slot] = (int8_t)(hash & 0x7f);
+    table->slots[free_slot] = entry;
+    table->count++;
+
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_insert(hash_table_t *table, void *entry) {
+    void *existing;
+    return hash_table_insert_or_get(table, entry, &existing);
+}
+
+dsa_status_t hash_table_insert_or_get(hash_table_t *table, void *entry, void **existing) {
+    if (!table || !entry || !existing) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(entry));
+    long free_slot;
+    long slot = _hash_table_find_slot(table, hash, entry, &free_slot);
+    if (slot >= 0) {
+        *existing = table->slots[slot];
+        return DSA_EXISTS;
+    }
+
+    *existing = entry;
+    return _hash_table_place(table, hash, free_slot, entry);
+}
+
+dsa_status_t hash_table_upsert(hash_table_t *table, void *entry, void **old_entry) {
+    if (!table || !entry || !old_entry) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(entry));
+    long free_slot;
+    long slot = _hash_table_find_slot(table, hash, entry, &free_slot);
+    if (slot >= 0) {
+        *old_entry = table->slots[slot];
+        table->slots[slot] = entry;
+        return DSA_OK;
+    }
+
+    *old_entry = NULL;
+    return _hash_table_place(table, hash, free_slot, entry);
+}
+
+dsa_status_t hash_table_find_or_insert_with(hash_table_t *table, void *key,
+                                            hash_table_entry_factory factory, void *context,
+                                            void **result) {
+    if (!table || !key || !factory || !result) {
+        return DSA_BAD_PARAM;
+    }
+
+    unsigned int hash = _hash_table_mix(table->hash_func(key));
+    long free_slot;
+    long slot = _hash_table_find_slot(table, hash, key, &free_slot);
+    if (slot >= 0) {
+        *result = table->slots[slot];
+        return DSA_EXISTS;
+    }
+
+    *result = factory(key, context);
+    if (!*result) {
+        return DSA_ERROR;
+    }
+    return _hash_table_place(table, hash, free_slot, *result);
+}
+
+void *hash_table_find(hash_table_t *table, void *entry) {
+    if (!table || !entry) {
+        return NULL;
+    }
+
+    long slot = _hash_table_find_slot(table, _hash_table_mix(table->hash_func(entry)), entry, NULL);
+    return slot >= 0 ? table->slots[slot] : NULL;
+}
+
+/* Hashes a group of keys and issues the loads of their lookups one stage at a
+ * time (first control group, slot of the first h2 match, its entry) so that
+ * the misses of the whole group are in flight together. */
+static void _hash_table_prefetch_group(hash_table_t *table, void **keys, size_t n, unsigned int *hashes) {
+    unsigned int group_mask = table->capacity / GROUP_SIZE - 1;
+
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = _hash_table_mix(table->hash_func(keys[i]));
+        __builtin_prefetch(table->ctrl + (size_t)((hashes[i] >> 7) & group_mask) * GROUP_SIZE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t group = (size_t)((hashes[i] >> 7) & group_mask) * GROUP_SIZE;
+        group_mask_t match = _group_match(table->ctrl + group, (int8_t)(hashes[i] & 0x7f));
+        if (match) {
+            __builtin_prefetch(&table->slots[group + __builtin_ctz(match)]);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t group = (size_t)((hashes[i] >> 7) & group_mask) * GROUP_SIZE;
+        group_mask_t match = _group_match(table->ctrl + group, (int8_t)(hashes[i] & 0x7f));
+        if (match) {
+            __builtin_prefetch(table->slots[group + __builtin_ctz(match)]);
+        }
+    }
+}
+
+dsa_status_t hash_table_find_batch(hash_table_t *table, void **keys, size_t count, void **results) {
+    if (!table || !keys || !results) {
+        return DSA_BAD_PARAM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!keys[i]) {
+            return DSA_BAD_PARAM;
+        }
+    }
+
+    unsigned int hashes[HASH_TABLE_BATCH];
+    for (size_t base = 0; base < count; base += HASH_TABLE_BATCH) {
+        size_t n = count - base < HASH_TABLE_BATCH ? count - base : HASH_TABLE_BATCH;
+        _hash_table_prefetch_group(table, keys + base, n, hashes);
+        for (size_t i = 0; i < n; i++) {
+            long slot = _hash_table_find_slot(table, hashes[i], keys[base + i], NULL);
+            results[base + i] = slot >= 0 ? table->slots[slot] : NULL;
+        }
+    }
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_insert_batch(hash_table_t *table, void **entries, size_t count, dsa_status_t *statuses) {
+    if (!table || !entries) {
+        return DSA_BAD_PARAM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!entries[i]) {
+            return DSA_BAD_PARAM;
+        }
+    }
+
+    dsa_status_t result = DSA_OK;
+    unsigned int hashes[HASH_TABLE_BATCH];
+    for (size_t base = 0; base < count; base += HASH_TABLE_BATCH) {
+        size_t n = count - base < HASH_TABLE_BATCH ? count - base : HASH_TABLE_BATCH;
+        _hash_table_prefetch_group(table, entries + base, n, hashes);
+        for (size_t i = 0; i < n; i++) {
+            void *entry = entries[base + i];
+            long free_slot;
+            dsa_status_t status = _hash_table_find_slot(table, hashes[i], entry, &free_slot) >= 0
+                                      ? DSA_EXISTS
+                                      : _hash_table_place(table, hashes[i], free_slot, entry);
+            if (status == DSA_ERROR) {
+                result = DSA_ERROR;
+            }
+            if (statuses) {
+                statuses[base + i] = status;
+            }
+        }
+    }
+    return result;
+}
+
+dsa_status_t hash_table_remove(hash_table_t *table, void *entry) {
+    if (!table || !entry) {
+        return DSA_BAD_PARAM;
+    }
+
+    long slot = _hash_table_find_slot(table, _hash_table_mix(table->hash_func(entry)), entry, NULL);
+    if (slot < 0) {
+        return DSA_NOT_FOUND;
+    }
+
+    /* A group that still has an EMPTY slot has never been full since the last
+     * rebuild, so no probe sequence ever continued past it and the slot can go
+     * straight back to EMPTY. Only slots of full groups need a tombstone. */
+    if (_group_match_empty(table->ctrl + (slot & ~(long)(GROUP_SIZE - 1)))) {
+        table->ctrl[slot] = CTRL_EMPTY;
+        table->growth_left++;
+    } else {
+        table->ctrl[slot] = CTRL_DELETED;
+    }
+    table->count--;
+
+    _hash_table_shrink_if_needed(table);
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_foreach(hash_table_t *table, hash_table_entry_action entry_action) {
+    if (!table || !entry_action) {
+        return DSA_BAD_PARAM;
+    }
+
+    for (unsigned int i = 0; i < table->capacity; i++) {
+        if (table->ctrl[i] >= 0) {
+            entry_action(table->slots[i]);
+        }
+    }
+
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_foreach_ctx(hash_table_t *table, hash_table_entry_visitor visitor, void *context) {
+    if (!table || !visitor) {
+        return DSA_BAD_PARAM;
+    }
+
+    for (unsigned int i = 0; i < table->capacity; i++) {
+        if (table->ctrl[i] >= 0 && !visitor(table->slots[i], context)) {
+            break;
+        }
+    }
+
+    return DSA_OK;
+}
+
+/* One thread's share of a parallel foreach: slots [first, last), whole groups. */
+typedef struct
+{
+    hash_table_t *table;
+    hash_table_entry_visitor visitor;
+    void *context;
+    size_t first;
+    size_t last;
+    int *stop;
+    pthread_t thread;
+    bool started;
+} hash_table_walk_t;
+
+static void *_hash_table_walk_range(void *arg) {
+    hash_table_walk_t *walk = arg;
+    hash_table_t *table = walk->table;
+
+    for (size_t group = walk->first; group < walk->last; group += GROUP_SIZE) {
+        if (__atomic_load_n(walk->stop, __ATOMIC_RELAXED)) {
+            break;
+        }
+        for (size_t i = group; i < group + GROUP_SIZE; i++) {
+            if (table->ctrl[i] >= 0 && !walk->visitor(table->slots[i], walk->context)) {
+                __atomic_store_n(walk->stop, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+dsa_status_t hash_table_parallel_foreach(hash_table_t *table, hash_table_entry_visitor visitor, void *context,
+                                         unsigned int threads) {
+    if (!table || !visitor || threads == 0) {
+        return DSA_BAD_PARAM;
+    }
+
+    size_t groups = table->capacity / GROUP_SIZE;
+    if (threads > groups) {
+        threads = (unsigned int)groups;
+    }
+
+    hash_table_walk_t *walks = table->allocator.alloc(threads * sizeof(hash_table_walk_t), table->allocator.context);
+    if (!walks) {
+        return DSA_ERROR;
+    }
+
+    int stop = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        walks[t] = (hash_table_walk_t){.table = table, .visitor = visitor, .context = context,
+                                       .first = groups * t / threads * GROUP_SIZE,
+                                       .last = groups * (t + 1) / threads * GROUP_SIZE,
+                                       .stop = &stop};
+        walks[t].started = t > 0 && pthread_create(&walks[t].thread, NULL, _hash_table_walk_range, &walks[t]) == 0;
+    }
+
+    /* The calling thread takes the first range itself. */
+    _hash_table_walk_range(&walks[0]);
+
+    dsa_status_t status = DSA_OK;
+    for (unsigned int t = 1; t < threads; t++) {
+        if (walks[t].started) {
+            pthread_join(walks[t].thread, NULL);
+        } else {
+            status = DSA_ERROR;
+        }
+    }
+    table->allocator.free(walks, threads * sizeof(hash_table_walk_t), table->allocator.context);
+    return status;
+}
+
+dsa_status_t hash_table_iterator_begin(hash_table_t *table, hash_table_iterator_t *iterator) {
+    if (!table || !iterator) {
+        return DSA_BAD_PARAM;
+    }
+
+    table->iterators++;
+    iterator->table = table;
+    iterator->array = 0;
+    iterator->position = 0;
+    iterator->node = NULL;
+    return DSA_OK;
+}
+
+/* Removing an entry only rewrites its control byte, so slots never move
+ * while the iterator is open. */
+void *hash_table_iterator_next(hash_table_iterator_t *iterator) {
+    hash_table_t *table = iterator->table;
+
+    while (iterator->position < table->capacity) {
+        size_t slot = iterator->position++;
+        if (table->ctrl[slot] >= 0) {
+            return table->slots[slot];
+        }
+    }
+    return NULL;
+}
+
+void hash_table_iterator_end(hash_table_iterator_t *iterator) {
+    hash_table_t *table = iterator->table;
+    if (--table->iterators == 0) {
+        _hash_table_shrink_if_needed(table);
+    }
+}
+
+size_t hash_table_size(hash_table_t *table) {
+    return table ? table->count : 0;
+}
+
+dsa_status_t hash_table_set_load_factors(hash_table_t *table, float max_load_factor, float min_load_factor) {
+    if (!table || !(max_load_factor > 0.0f) || !(min_load_factor >= 0.0f) ||
+        !(min_load_factor < max_load_factor / 2)) {
+        return DSA_BAD_PARAM;
+    }
+
+    /* Open addressing needs free slots to terminate probes. */
+    if (max_load_factor > HASH_TABLE_SWISS_MAX_LOAD_FACTOR) {
+        max_load_factor = HASH_TABLE_SWISS_MAX_LOAD_FACTOR;
+    }
+    table->max_load_factor = max_load_factor;
+    table->min_load_factor = min_load_factor < max_load_factor / 2 ? min_load_factor : max_load_factor / 4;
+
+    unsigned int capacity = table->capacity;
+    while (capacity < HASH_TABLE_MAX_CAPACITY && table->count >= _hash_table_growth_limit(capacity, max_load_factor)) {
+        capacity <<= 1;
+    }
+    if (_hash_table_resize(table, capacity) != DSA_OK) {
+        return DSA_ERROR;
+    }
+    _hash_table_shrink_if_needed(table);
+    return DSA_OK;
+}
+
+dsa_status_t hash_table_set_rehash_mode(hash_table_t *table, hash_table_rehash_mode_t mode) {
+    /* Rebuilds are always done in one step here. */
+    if (!table || mode != HASH_TABLE_REHASH_BLOCKING) {
+        return DSA_BAD_PARAM;
+    }
+    return DSA_OK;
+}
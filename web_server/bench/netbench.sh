@@ -0,0 +1,221 @@
+#!/bin/bash
+
+# Benchmark bed built like linux_network_hw/topology.sh: the server and every load
+# generator get their own namespace, all cabled by veth pairs to a bridge in WsRouter.
+# netem runs on the router's egress ports, so each direction is shaped once and
+# the round trip is 2 * DELAY.
+#
+#   CLIENT 1..N (10.77.0.11..) --veth--+
+#                                      +-- brb (WsRouter) --veth-- SERVER (10.77.0.1)
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SERVER_BIN=${SERVER_BIN:-$BENCH_DIR/../main}
+WSLOAD_BIN=${WSLOAD_BIN:-$BENCH_DIR/../tools/wsload}
+WORK_DIR=${WORK_DIR:-/tmp/netbench}
+RESULTS_DIR=${RESULTS_DIR:-$WORK_DIR/results}
+
+CLIENTS=${CLIENTS:-2}
+SERVER_ADDR=10.77.0.1
+SERVER_PORT=8080
+
+CONNS=${CONNS:-16}
+DURATION=${DURATION:-10}
+DEPTH=${DEPTH:-4}
+TARGET_PATH=${TARGET_PATH:-/small.html}
+
+function router_ports() {
+    echo VethSr
+    for i in $(seq 1 "$CLIENTS"); do echo "VethC${i}r"; done
+}
+
+function create_lab() {
+    ip netns add WsServer
+    ip netns add WsRouter
+
+    ip netns exec WsRouter ip link add brb type bridge
+    ip netns exec WsRouter ip link set brb up
+    ip netns exec WsRouter ip link set lo up
+
+    ip link add VethS type veth peer name VethSr
+    ip link set VethS netns WsServer
+    ip link set VethSr netns WsRouter
+    ip netns exec WsServer ip addr add $SERVER_ADDR/24 dev VethS
+    ip netns exec WsServer ip link set VethS up
+    ip netns exec WsServer ip link set lo up
+    ip netns exec WsRouter ip link set VethSr master brb
+    ip netns exec WsRouter ip link set VethSr up
+
+    for i in $(seq 1 "$CLIENTS"); do
+        ip netns add WsClient$i
+        ip link add VethC$i type veth peer name VethC${i}r
+        ip link set VethC$i netns WsClient$i
+        ip link set VethC${i}r netns WsRouter
+        ip netns exec WsClient$i ip addr add 10.77.0.$((10 + i))/24 dev VethC$i
+        ip netns exec WsClient$i ip link set VethC$i up
+        ip netns exec WsClient$i ip link set lo up
+        ip netns exec WsRouter ip link set VethC${i}r master brb
+        ip netns exec WsRouter ip link set VethC${i}r up
+    done
+
+    echo "---All done---"
+}
+
+function clean_lab() {
+    stop_server
+    for ns in $(ip netns list | awk '/^Ws(Server|Router|Client[0-9]+)/ {print $1}'); do
+        ip netns del "$ns" 2>/dev/null
+    done
+}
+
+# Profiles set one-way DELAY/JITTER/LOSS/RATE; variables already in the
+# environment win, so "DELAY=80ms ./netbench.sh run wan" works.
+function load_profile() {
+    case "$1" in
+        lan)   : "${DELAY:=0ms}"  "${JITTER:=0ms}" "${LOSS:=0%}" "${RATE:=}" ;;
+        wan)   : "${DELAY:=20ms}" "${JITTER:=2ms}" "${LOSS:=0%}" "${RATE:=}" ;;
+        lossy) : "${DELAY:=20ms}" "${JITTER:=2ms}" "${LOSS:=1%}" "${RATE:=}" ;;
+        slow)  : "${DELAY:=50ms}" "${JITTER:=5ms}" "${LOSS:=0%}" "${RATE:=10mbit}" ;;
+        *)
+            echo "Error: unknown profile $1 (lan, wan, lossy, slow)"
+            exit 1
+            ;;
+    esac
+}
+
+function apply_netem() {
+    local args="delay $DELAY"
+    [ "$JITTER" != "0ms" ] && args="$args $JITTER distribution normal"
+    [ "$LOSS" != "0%" ] && args="$args loss $LOSS"
+    [ -n "$RATE" ] && args="$args rate $RATE"
+
+    for dev in $(router_ports); do
+        ip netns exec WsRouter tc qdisc del dev "$dev" root 2>/dev/null
+    done
+    if [ "$DELAY" = "0ms" ] && [ "$LOSS" = "0%" ] && [ -z "$RATE" ]; then
+        echo "netem: off"
+        return
+    fi
+    for dev in $(router_ports); do
+        ip netns exec WsRouter tc qdisc add dev "$dev" root netem $args limit 100000 || exit 1
+    done
+    echo "netem: $args"
+}
+
+function start_server() {
+    mkdir -p "$WORK_DIR/www" "$WORK_DIR/uploads"
+    head -c 1024 /dev/urandom | base64 > "$WORK_DIR/www/small.html"
+    head -c 1048576 /dev/urandom > "$WORK_DIR/www/large.bin"
+    cat > "$WORK_DIR/server.conf" <<EOF
+port=$SERVER_PORT
+ip=$SERVER_ADDR
+root_dir=$WORK_DIR/www
+storage_dir=$WORK_DIR/uploads
+max_clients=4096
+log_file=$WORK_DIR/server.log
+keep_alive_timeout=30
+access_log=$WORK_DIR/access
+EOF
+    rm -f "$WORK_DIR"/access.*.bin
+    ip netns exec WsServer sh -c "cd '$WORK_DIR' && exec '$SERVER_BIN'" > /dev/null 2>&1 &
+    echo $! > "$WORK_DIR/server.pid"
+
+    for _ in $(seq 1 50); do
+        ip netns exec WsClient1 bash -c "echo > /dev/tcp/$SERVER_ADDR/$SERVER_PORT" 2>/dev/null && return 0
+        sleep 0.1
+    done
+    echo "Error: server did not come up, see $WORK_DIR/server.log"
+    exit 1
+}
+
+function stop_server() {
+    [ -f "$WORK_DIR/server.pid" ] || return
+    kill "$(cat "$WORK_DIR/server.pid")" 2>/dev/null
+    sleep 0.5
+    rm -f "$WORK_DIR/server.pid"
+}
+
+# One wsload per client namespace, all at once; their raw counters are merged
+# into a single report. $1 = mode: close, keepalive or pipeline.
+function run_load() {
+    local mode=$1 name=$2 flags
+    case "$mode" in
+        close)     flags="" ;;
+        keepalive) flags="-k" ;;
+        pipeline)  flags="-k -p $DEPTH" ;;
+        *)
+            echo "Error: unknown mode $mode (close, keepalive, pipeline)"
+            exit 1
+            ;;
+    esac
+
+    local parts=() pids=()
+    for i in $(seq 1 "$CLIENTS"); do
+        local part="$RESULTS_DIR/$name.client$i.bin"
+        parts+=("$part")
+        ip netns exec WsClient$i "$WSLOAD_BIN" -c "$CONNS" -d "$DURATION" $flags -o "$part" \
+            "$SERVER_ADDR:$SERVER_PORT" "$TARGET_PATH" > "$RESULTS_DIR/$name.client$i.txt" &
+        pids+=($!)
+    done
+    wait "${pids[@]}"
+
+    "$WSLOAD_BIN" -m "${parts[@]}" > "$RESULTS_DIR/$name.txt"
+    rm -f "${parts[@]}"
+    echo "== $name"
+    cat "$RESULTS_DIR/$name.txt"
+}
+
+function run_bench() {
+    local profile=${1:-lan} mode=${2:-keepalive}
+    load_profile "$profile"
+    mkdir -p "$RESULTS_DIR"
+    apply_netem
+    start_server
+    run_load "$mode" "$profile-$mode"
+    stop_server
+}
+
+function sweep() {
+    mkdir -p "$RESULTS_DIR"
+    for profile in lan wan lossy slow; do
+        (
+            load_profile "$profile"
+            apply_netem
+            start_server
+            for mode in close keepalive pipeline; do
+                run_load "$mode" "$profile-$mode"
+            done
+            stop_server
+        )
+    done
+
+    printf "%-18s %12s %10s %10s %10s\n" "run" "req/s" "p50_us" "p99_us" "errors"
+    for profile in lan wan lossy slow; do
+        for mode in close keepalive pipeline; do
+            awk -v run="$profile-$mode" '
+                $1 == "requests_per_second" { rps = $2 }
+                $1 == "errors" { errors = $2 }
+                $1 == "latency_us" { split($2, a, "="); p50 = a[2]; split($4, b, "="); p99 = b[2] }
+                END { printf "%-18s %12s %10s %10s %10s\n", run, rps, p50, p99, errors }
+            ' "$RESULTS_DIR/$profile-$mode.txt"
+        done
+    done
+}
+
+case "$1" in
+    create)
+        create_lab
+        ;;
+    clear)
+        clean_lab
+        ;;
+    run)
+        run_bench "$2" "$3"
+        ;;
+    sweep)
+        sweep
+        ;;
+    *)
+        echo "Usage: $0 create | run [lan|wan|lossy|slow] [close|keepalive|pipeline] | sweep | clear"
+        exit 1
+        ;;
+esac
@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include "server.h"
+#include "accesslog.h"
+
+AccessLog access_log;
+
+uint64_t access_log_hash(const char *path) {
+    uint64_t h = 14695981039346656037ull;
+    for (; *path; path++) {
+        h ^= (unsigned char)*path;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static void segment_path(unsigned int segment, char *out, size_t size) {
+    snprintf(out, size, "%s.%06u.bin", access_log.prefix, segment);
+}
+
+/* Any process may be the first to touch a segment: O_CREAT plus ftruncate to the
+   fixed size is idempotent, so no one has to wait for a creator. */
+static int map_segment(unsigned int segment) {
+    if (access_log.records && access_log.mapped_segment == segment) return 0;
+
+    char path[300];
+    segment_path(segment, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, access_log.segment_bytes) < 0) {
+        close(fd);
+        return -1;
+    }
+    void *records = mmap(NULL, access_log.segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (records == MAP_FAILED) return -1;
+
+    if (access_log.records) munmap(access_log.records, access_log.segment_bytes);
+    access_log.records = records;
+    access_log.mapped_segment = segment;
+    return 0;
+}
+
+/* Continues after the highest segment already on disk instead of appending to it:
+   the slot counter of a previous run is unknown. */
+static unsigned int next_segment_number(void) {
+    char pattern[300];
+    snprintf(pattern, sizeof(pattern), "%s.*.bin", access_log.prefix);
+
+    unsigned int next = 0;
+    glob_t found;
+    if (glob(pattern, 0, NULL, &found) == 0) {
+        size_t prefix_len = strlen(access_log.prefix);
+        for (size_t i = 0; i < found.gl_pathc; i++) {
+            unsigned int n;
+            if (sscanf(found.gl_pathv[i] + prefix_len, ".%u.bin", &n) == 1 && n >= next) next = n + 1;
+        }
+        globfree(&found);
+    }
+    return next;
+}
+
+int access_log_init(const char *prefix, int segment_mb) {
+    memset(&access_log, 0, sizeof(access_log));
+    if (!prefix || prefix[0] == '\0' || strcmp(prefix, "off") == 0) return 0;
+
+    snprintf(access_log.prefix, sizeof(access_log.prefix), "%s", prefix);
+    access_log.slots = ((size_t)(segment_mb > 0 ? segment_mb : 64) << 20) / sizeof(AccessRecord);
+    access_log.segment_bytes = (size_t)access_log.slots * sizeof(AccessRecord);
+
+    access_log.shared = mmap(NULL, sizeof(AccessLogShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (access_log.shared == MAP_FAILED) {
+        access_log.shared = NULL;
+        return -1;
+    }
+
+    unsigned int segment = next_segment_number();
+    access_log.shared->position = (unsigned long long)segment << 32;
+    if (map_segment(segment) < 0) {
+        munmap(access_log.shared, sizeof(AccessLogShared));
+        access_log.shared = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int access_log_enabled(void) {
+    return access_log.shared != NULL;
+}
+
+/* Called by the master before fork() so the worker inherits the current segment. */
+void access_log_refresh(void) {
+    if (!access_log.shared) return;
+    map_segment(__atomic_load_n(&access_log.shared->position, __ATOMIC_ACQUIRE) >> 32);
+}
+
+static AccessRecord *reserve_record(void) {
+    for (;;) {
+        unsigned long long pos = __atomic_fetch_add(&access_log.shared->position, 1, __ATOMIC_ACQ_REL);
+        unsigned int segment = pos >> 32;
+        unsigned int slot = pos & 0xffffffffu;
+
+        if (slot < access_log.slots) {
+            if (map_segment(segment) < 0) return NULL;
+            return &access_log.records[slot];
+        }
+        /* Exactly one writer sees the first slot past the end; it opens the next
+           segment. Everyone else that overflowed retries until it has. */
+        if (slot == access_log.slots)
+            __atomic_store_n(&access_log.shared->position, (unsigned long long)(segment + 1) << 32, __ATOMIC_RELEASE);
+        else
+            sched_yield();
+    }
+}
+
+void access_log_write(const struct sockaddr_storage *peer, int method, const char *path,
+                      int status, unsigned long long bytes, long long latency_us) {
+    if (!access_log.shared) return;
+    AccessRecord *record = reserve_record();
+    if (!record) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->time_us = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    record->bytes = bytes;
+    record->path_hash = access_log_hash(path);
+    record->latency_us = latency_us > 0 ? (latency_us > UINT32_MAX ? UINT32_MAX : latency_us) : 0;
+    record->status = status;
+    record->method = method;
+    record->family = peer ? peer->ss_family : 0;
+    memset(record->addr, 0, sizeof(record->addr));
+    if (record->family == AF_INET)
+        memcpy(record->addr, &((const struct sockaddr_in *)peer)->sin_addr, 4);
+    else if (record->family == AF_INET6)
+        memcpy(record->addr, &((const struct sockaddr_in6 *)peer)->sin6_addr, 16);
+
+    size_t len = strlen(path);
+    record->path_len = len > UINT16_MAX ? UINT16_MAX : len;
+    memset(record->path, 0, sizeof(record->path));
+    memcpy(record->path, path, len < sizeof(record->path) ? len : sizeof(record->path));
+    __atomic_store_n(&record->commit, ACCESS_LOG_MAGIC, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,55 @@
+#ifndef accesslog_h
+#define accesslog_h
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#define ACCESS_LOG_MAGIC 0x41434c31u
+#define ACCESS_LOG_PATH_MAX 40
+
+/* One request, 96 bytes, native byte order. commit is stored last (release), so a
+   record whose commit is not ACCESS_LOG_MAGIC is unfinished and must be skipped.
+   path holds the first ACCESS_LOG_PATH_MAX bytes; path_hash covers the whole path. */
+typedef struct {
+    uint64_t time_us;
+    uint64_t bytes;
+    uint64_t path_hash;
+    uint32_t latency_us;
+    uint16_t status;
+    uint8_t method;
+    uint8_t family;
+    uint8_t addr[16];
+    uint16_t path_len;
+    uint16_t reserved;
+    uint32_t commit;
+    char path[ACCESS_LOG_PATH_MAX];
+} AccessRecord;
+
+/* position is shared by every process: segment number in the high 32 bits,
+   next free slot in the low 32 bits. */
+typedef struct {
+    unsigned long long position;
+} AccessLogShared;
+
+/* Segments are PREFIX.NNNNNN.bin files of a fixed size. Each process maps the
+   segment it is writing; the master keeps the current one mapped so a forked
+   worker usually inherits it. */
+typedef struct {
+    char prefix[256];
+    size_t segment_bytes;
+    unsigned int slots;
+    AccessLogShared *shared;
+    unsigned int mapped_segment;
+    AccessRecord *records;
+} AccessLog;
+
+extern AccessLog access_log;
+
+int access_log_init(const char *prefix, int segment_mb);
+int access_log_enabled(void);
+void access_log_refresh(void);
+void access_log_write(const struct sockaddr_storage *peer, int method, const char *path,
+                      int status, unsigned long long bytes, long long latency_us);
+uint64_t access_log_hash(const char *path);
+
+#endif
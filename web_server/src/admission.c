@@ -0,0 +1,94 @@
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "server.h"
+#include "admission.h"
+
+static const char SHED_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 5\r\n"
+    "Retry-After: 1\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Busy\n";
+
+static unsigned int isqrt(unsigned int n) {
+    unsigned int x = n, y = (n + 1) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + n / x) / 2;
+    }
+    return x ? x : 1;
+}
+
+int admission_init(AdmissionControl *ac, int max_inflight, int target_ms, int interval_ms) {
+    ac->max_inflight = max_inflight;
+    ac->target_us = (long long)target_ms * 1000;
+    ac->interval_us = (long long)interval_ms * 1000;
+    ac->state = mmap(NULL, sizeof(AdmissionState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ac->state == MAP_FAILED) {
+        ac->state = NULL;
+        return -1;
+    }
+    memset(ac->state, 0, sizeof(AdmissionState));
+    return 0;
+}
+
+int admission_over_limit(const AdmissionControl *ac) {
+    if (!ac->state || ac->max_inflight <= 0) return 0;
+    return __atomic_load_n(&ac->state->inflight, __ATOMIC_RELAXED) >= ac->max_inflight;
+}
+
+void admission_enter(AdmissionControl *ac) {
+    if (ac->state) __atomic_add_fetch(&ac->state->inflight, 1, __ATOMIC_RELAXED);
+}
+
+void admission_leave(AdmissionControl *ac) {
+    if (ac->state) __atomic_sub_fetch(&ac->state->inflight, 1, __ATOMIC_RELAXED);
+}
+
+/* CoDel-style control law applied to the accept -> first processing delay.
+   Returns 1 when this connection should be shed. */
+int admission_check_delay(AdmissionControl *ac, long long accepted_at_us) {
+    if (!ac->state || ac->target_us <= 0) return 0;
+
+    AdmissionState *st = ac->state;
+    long long now = monotonic_us();
+    long long sojourn = now - accepted_at_us;
+
+    if (sojourn < ac->target_us) {
+        __atomic_store_n(&st->first_above_us, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->dropping, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    long long first_above = __atomic_load_n(&st->first_above_us, __ATOMIC_RELAXED);
+    if (first_above == 0) {
+        __atomic_store_n(&st->first_above_us, now + ac->interval_us, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if (now < first_above) return 0;
+
+    if (!__atomic_exchange_n(&st->dropping, 1, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&st->drop_count, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->drop_next_us, now + ac->interval_us, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    long long drop_next = __atomic_load_n(&st->drop_next_us, __ATOMIC_RELAXED);
+    if (now < drop_next) return 0;
+
+    unsigned int count = __atomic_add_fetch(&st->drop_count, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->drop_next_us, now + ac->interval_us / isqrt(count), __ATOMIC_RELAXED);
+    return 1;
+}
+
+void admission_shed(AdmissionControl *ac, int socket) {
+    char scratch[1024];
+    for (int i = 0; i < 16 && recv(socket, scratch, sizeof(scratch), MSG_DONTWAIT) > 0; i++);
+
+    if (ac->state) __atomic_add_fetch(&ac->state->shed_total, 1, __ATOMIC_RELAXED);
+    send(socket, SHED_RESPONSE, sizeof(SHED_RESPONSE) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
@@ -0,0 +1,29 @@
+#ifndef admission_h
+#define admission_h
+
+/* Lives in a MAP_SHARED page created before the first fork(), so the master and
+   every worker see the same counters. All fields are touched with __atomic builtins. */
+typedef struct {
+    int inflight;
+    int dropping;
+    unsigned int drop_count;
+    unsigned long shed_total;
+    long long first_above_us;
+    long long drop_next_us;
+} AdmissionState;
+
+typedef struct {
+    int max_inflight;
+    long long target_us;
+    long long interval_us;
+    AdmissionState *state;
+} AdmissionControl;
+
+int admission_init(AdmissionControl *ac, int max_inflight, int target_ms, int interval_ms);
+int admission_over_limit(const AdmissionControl *ac);
+void admission_enter(AdmissionControl *ac);
+void admission_leave(AdmissionControl *ac);
+int admission_check_delay(AdmissionControl *ac, long long accepted_at_us);
+void admission_shed(AdmissionControl *ac, int socket);
+
+#endif
@@ -0,0 +1,88 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "server.h"
+#include "affinity.h"
+
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+
+static int affinity_add_cpu(AffinityPlan *plan, int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE || plan->cpu_count >= MAX_AFFINITY_CPUS) return -1;
+    plan->cpus[plan->cpu_count++] = cpu;
+    return 0;
+}
+
+int affinity_parse(const char *spec, AffinityPlan *plan) {
+    memset(plan, 0, sizeof(*plan));
+
+    if (!spec || spec[0] == '\0' || strcmp(spec, "off") == 0) return 0;
+
+    if (strcmp(spec, "incoming") == 0 || strcmp(spec, "roundrobin") == 0) {
+        plan->mode = spec[0] == 'i' ? AFFINITY_INCOMING : AFFINITY_ROUND_ROBIN;
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) return -1;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) affinity_add_cpu(plan, cpu);
+        }
+        return 0;
+    }
+
+    plan->mode = AFFINITY_LIST;
+    const char *p = spec;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) return -1;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (affinity_add_cpu(plan, cpu) < 0) return -1;
+        }
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return -1;
+    }
+    return plan->cpu_count > 0 ? 0 : -1;
+}
+
+int affinity_pin_self(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+/* Pins the calling worker and switches it to node-local allocation. Must run before
+   the worker writes to its buffers: they are inherited copy-on-write from the master,
+   so the first write places the worker's private copy on the node of the pinned CPU. */
+int affinity_place_worker(const AffinityPlan *plan, int socket, unsigned long seq) {
+    if (plan->mode == AFFINITY_OFF || plan->cpu_count == 0) return -1;
+
+    int cpu = -1;
+    if (plan->mode == AFFINITY_INCOMING) {
+        socklen_t len = sizeof(cpu);
+        if (getsockopt(socket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) cpu = -1;
+        int allowed = 0;
+        for (int i = 0; i < plan->cpu_count && !allowed; i++) allowed = plan->cpus[i] == cpu;
+        if (!allowed) cpu = -1;
+    }
+    if (cpu < 0) cpu = plan->cpus[seq % plan->cpu_count];
+
+    if (affinity_pin_self(cpu) < 0) {
+        LOG_WARN("[PID:%d] Cannot pin worker to CPU %d", getpid(), cpu);
+        return -1;
+    }
+    syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0);
+    return cpu;
+}
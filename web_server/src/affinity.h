@@ -0,0 +1,24 @@
+#ifndef affinity_h
+#define affinity_h
+
+#define MAX_AFFINITY_CPUS 256
+
+typedef enum {
+    AFFINITY_OFF = 0,
+    AFFINITY_INCOMING,
+    AFFINITY_ROUND_ROBIN,
+    AFFINITY_LIST
+} AffinityMode;
+
+/* "worker_affinity=off|incoming|roundrobin|0,2,4-7" */
+typedef struct {
+    AffinityMode mode;
+    short cpus[MAX_AFFINITY_CPUS];
+    int cpu_count;
+} AffinityPlan;
+
+int affinity_parse(const char *spec, AffinityPlan *plan);
+int affinity_pin_self(int cpu);
+int affinity_place_worker(const AffinityPlan *plan, int socket, unsigned long seq);
+
+#endif
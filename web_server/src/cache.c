@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "server.h"
+#include "cache.h"
+#include "compress.h"
+
+ContentCache content_cache;
+
+/* Requests per served path, preloaded or not, so the manifest learns files that did not
+   fit the last budget. Workers claim a slot by CAS on the path's 64-bit hash and never
+   free it; the path is readable once ready is set. */
+#define CACHE_PATH_SLOTS 4096
+#define CACHE_PATH_PROBES 32
+
+typedef struct {
+    unsigned long long key;
+    unsigned long hits;
+    int ready;
+    char path[512];
+} CachePathCount;
+
+static CachePathCount *path_counts = NULL;
+
+static const char *walk_skip_dirs[2];
+
+static unsigned int cache_hash(const char *path) {
+    unsigned int h = 2166136261u;
+    for (; *path; path++) {
+        h ^= (unsigned char)*path;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned long long cache_hash64(const char *path) {
+    unsigned long long h = 14695981039346656037ull;
+    for (; *path; path++) {
+        h ^= (unsigned char)*path;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+int cache_init(size_t max_bytes) {
+    memset(&content_cache, 0, sizeof(content_cache));
+    content_cache.max_bytes = max_bytes;
+    content_cache.hits = mmap(NULL, CACHE_MAX_ENTRIES * sizeof(unsigned long), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (content_cache.hits == MAP_FAILED) {
+        content_cache.hits = NULL;
+        return -1;
+    }
+    path_counts = mmap(NULL, CACHE_PATH_SLOTS * sizeof(CachePathCount), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (path_counts == MAP_FAILED) {
+        path_counts = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+CacheEntry *cache_lookup(const char *path) {
+    if (content_cache.count == 0) return NULL;
+    unsigned int slot = cache_hash(path) & (CACHE_INDEX_SIZE - 1);
+    while (content_cache.index[slot]) {
+        CacheEntry *entry = &content_cache.entries[content_cache.index[slot] - 1];
+        if (strcmp(entry->path, path) == 0) return entry;
+        slot = (slot + 1) & (CACHE_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+int cache_entry_fresh(const CacheEntry *entry, const struct stat *st) {
+    return st->st_ino == entry->ino && (size_t)st->st_size == entry->size &&
+           st->st_mtim.tv_sec == entry->mtime.tv_sec && st->st_mtim.tv_nsec == entry->mtime.tv_nsec;
+}
+
+int cache_compress(CacheEntry *entry, int level) {
+    if (entry->gz_state == 0) {
+        entry->gz_state = gzip_compress(entry->data, entry->size, level, &entry->gz_data, &entry->gz_size) == 0 ? 1 : -1;
+    }
+    return entry->gz_state == 1 ? 0 : -1;
+}
+
+void cache_hit(const CacheEntry *entry) {
+    if (content_cache.hits && entry - content_cache.entries < content_cache.shared_count)
+        __atomic_add_fetch(&content_cache.hits[entry - content_cache.entries], 1, __ATOMIC_RELAXED);
+}
+
+/* Paths that hash alike share a count, and once the probe window is full a new path
+   goes uncounted: both only cost it a place in the next manifest. */
+void cache_count_request(const char *path) {
+    if (!path_counts || strlen(path) >= sizeof(path_counts[0].path)) return;
+    unsigned long long key = cache_hash64(path) | 1;
+    unsigned int slot = key & (CACHE_PATH_SLOTS - 1);
+    for (int probe = 0; probe < CACHE_PATH_PROBES; probe++, slot = (slot + 1) & (CACHE_PATH_SLOTS - 1)) {
+        CachePathCount *count = &path_counts[slot];
+        unsigned long long seen = __atomic_load_n(&count->key, __ATOMIC_ACQUIRE);
+        if (seen == 0) {
+            if (__atomic_compare_exchange_n(&count->key, &seen, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                strcpy(count->path, path);
+                __atomic_store_n(&count->ready, 1, __ATOMIC_RELEASE);
+                seen = key;
+            }
+        }
+        if (seen == key) {
+            __atomic_add_fetch(&count->hits, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+unsigned long cache_total_hits(void) {
+    unsigned long total = 0;
+    for (int i = 0; content_cache.hits && i < content_cache.shared_count; i++) {
+        total += __atomic_load_n(&content_cache.hits[i], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/* Returns 0 when the file is cached (or already was), -1 when it was skipped. */
+int cache_add(const char *path) {
+    if (content_cache.count >= CACHE_MAX_ENTRIES || strlen(path) >= sizeof(content_cache.entries[0].path)) return -1;
+    if (cache_lookup(path)) return 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+        content_cache.bytes + st.st_size > content_cache.max_bytes) {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    madvise(data, st.st_size, MADV_WILLNEED);
+
+    int idx = content_cache.count++;
+    CacheEntry *entry = &content_cache.entries[idx];
+    strcpy(entry->path, path);
+    entry->data = data;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtim;
+    entry->ino = st.st_ino;
+    entry->gz_data = NULL;
+    entry->gz_size = 0;
+    entry->gz_state = 0;
+    content_cache.bytes += st.st_size;
+
+    unsigned int slot = cache_hash(path) & (CACHE_INDEX_SIZE - 1);
+    while (content_cache.index[slot]) slot = (slot + 1) & (CACHE_INDEX_SIZE - 1);
+    content_cache.index[slot] = idx + 1;
+    return 0;
+}
+
+/* Manifest lines are "HITS PATH", hottest first. */
+int cache_preload_manifest(const char *manifest) {
+    FILE *f = fopen(manifest, "r");
+    if (!f) return 0;
+
+    int loaded = 0;
+    char line[600], path[512];
+    unsigned long hits;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lu %511s", &hits, path) == 2 && cache_add(path) == 0) loaded++;
+    }
+    fclose(f);
+    return loaded;
+}
+
+static int cache_walk_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (content_cache.count >= CACHE_MAX_ENTRIES) return FTW_STOP;
+    for (int i = 0; type == FTW_D && i < 2; i++) {
+        if (walk_skip_dirs[i] && strcmp(path, walk_skip_dirs[i]) == 0) return FTW_SKIP_SUBTREE;
+    }
+    if (type == FTW_F) cache_add(path);
+    return FTW_CONTINUE;
+}
+
+/* Skips storage_dir (uploads) and gzip_cache_dir (derived copies). */
+int cache_preload_dir(const char *root_dir, const char *storage_dir, const char *gzip_cache_dir) {
+    int before = content_cache.count;
+    walk_skip_dirs[0] = storage_dir;
+    walk_skip_dirs[1] = gzip_cache_dir;
+    nftw(root_dir, cache_walk_entry, 16, FTW_PHYS | FTW_ACTIONRETVAL);
+    walk_skip_dirs[0] = walk_skip_dirs[1] = NULL;
+    return content_cache.count - before;
+}
+
+static int cache_by_hits_desc(const void *a, const void *b) {
+    unsigned long ha = path_counts[*(const int *)a].hits;
+    unsigned long hb = path_counts[*(const int *)b].hits;
+    return ha < hb ? 1 : ha > hb ? -1 : 0;
+}
+
+int cache_save_manifest(const char *manifest) {
+    if (!path_counts) return -1;
+
+    static int order[CACHE_PATH_SLOTS];
+    int count = 0;
+    for (int i = 0; i < CACHE_PATH_SLOTS; i++) {
+        if (__atomic_load_n(&path_counts[i].ready, __ATOMIC_ACQUIRE) && path_counts[i].hits > 0) order[count++] = i;
+    }
+    qsort(order, count, sizeof(int), cache_by_hits_desc);
+
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", manifest);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    for (int i = 0; i < count; i++) {
+        fprintf(f, "%lu %s\n", path_counts[order[i]].hits, path_counts[order[i]].path);
+    }
+    fclose(f);
+    return rename(tmp, manifest);
+}
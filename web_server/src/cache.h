@@ -0,0 +1,52 @@
+#ifndef cache_h
+#define cache_h
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define CACHE_MAX_ENTRIES 1024
+#define CACHE_INDEX_SIZE 2048
+
+/* A file kept mapped for the whole life of the server. Workers inherit the
+   mapping through fork(), so the bytes are shared with the page cache.
+   gz_state: 0 not tried yet, 1 gz_data holds a gzip copy, -1 not worth compressing. */
+typedef struct {
+    char path[512];
+    void *data;
+    size_t size;
+    struct timespec mtime;
+    ino_t ino;
+    void *gz_data;
+    size_t gz_size;
+    int gz_state;
+} CacheEntry;
+
+/* Entries below shared_count were loaded by the master before the first fork and
+   are the same in every worker; a worker may append private entries after them. */
+typedef struct {
+    CacheEntry entries[CACHE_MAX_ENTRIES];
+    int count;
+    int shared_count;
+    size_t bytes;
+    size_t max_bytes;
+    short index[CACHE_INDEX_SIZE];
+    unsigned long *hits;
+} ContentCache;
+
+extern ContentCache content_cache;
+
+int cache_init(size_t max_bytes);
+int cache_add(const char *path);
+CacheEntry *cache_lookup(const char *path);
+int cache_entry_fresh(const CacheEntry *entry, const struct stat *st);
+int cache_compress(CacheEntry *entry, int level);
+void cache_hit(const CacheEntry *entry);
+void cache_count_request(const char *path);
+int cache_preload_manifest(const char *manifest);
+int cache_preload_dir(const char *root_dir, const char *storage_dir, const char *gzip_cache_dir);
+int cache_save_manifest(const char *manifest);
+unsigned long cache_total_hits(void);
+
+#endif
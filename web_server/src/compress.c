@@ -0,0 +1,114 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "server.h"
+#include "compress.h"
+
+/* One-shot gzip of an in-memory buffer. *out is malloc'ed and owned by the caller.
+   Returns -1 when compression fails or does not make the body smaller. */
+int gzip_compress(const void *data, size_t size, int level, void **out, size_t *out_size) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return -1;
+
+    size_t bound = deflateBound(&zs, size);
+    unsigned char *buf = malloc(bound);
+    if (!buf) {
+        deflateEnd(&zs);
+        return -1;
+    }
+
+    zs.next_in = (unsigned char *)data;
+    zs.avail_in = size;
+    zs.next_out = buf;
+    zs.avail_out = bound;
+    int rc = deflate(&zs, Z_FINISH);
+    size_t produced = bound - zs.avail_out;
+    deflateEnd(&zs);
+
+    if (rc != Z_STREAM_END || produced >= size) {
+        free(buf);
+        return -1;
+    }
+    *out = buf;
+    *out_size = produced;
+    return 0;
+}
+
+static int gzip_cache_fd = -1;
+
+/* Opened by the master; workers inherit the descriptor. */
+int gzip_cache_init(const char *dir) {
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) return -1;
+    gzip_cache_fd = open(dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    return gzip_cache_fd < 0 ? -1 : 0;
+}
+
+/* The name carries the source's inode, size and mtime, so an edited file never matches
+   an old copy. Superseded copies stay behind until the directory is cleaned. */
+static int gzip_cache_name(const char *rel, const struct stat *st, char *out, size_t size) {
+    unsigned long long h = 14695981039346656037ull;
+    for (const char *p = rel; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ull;
+    }
+    int n = snprintf(out, size, "%016llx-%llx-%llx-%llx.%lx.gz", h, (unsigned long long)st->st_ino,
+                     (unsigned long long)st->st_size, (unsigned long long)st->st_mtim.tv_sec, st->st_mtim.tv_nsec);
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+int gzip_cache_open(const char *rel, const struct stat *st, struct stat *gz_st) {
+    char name[128];
+    if (gzip_cache_fd < 0 || gzip_cache_name(rel, st, name, sizeof(name)) < 0) return -1;
+    int fd = openat(gzip_cache_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    if (fstat(fd, gz_st) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Written under a per-process temporary name and renamed into place, so a reader sees
+   either no copy or a complete one, whichever worker compressed it first. */
+int gzip_cache_store(const char *rel, const struct stat *st, const void *data, size_t size) {
+    char name[128], tmp[160];
+    if (gzip_cache_fd < 0 || gzip_cache_name(rel, st, name, sizeof(name)) < 0) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", name, (int)getpid());
+
+    int fd = openat(gzip_cache_fd, tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, (const char *)data + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    close(fd);
+    if (done < size || renameat(gzip_cache_fd, tmp, gzip_cache_fd, name) < 0) {
+        unlinkat(gzip_cache_fd, tmp, 0);
+        return -1;
+    }
+    return 0;
+}
+
+int accepts_gzip(const char *request_head) {
+    char value[256];
+    if (!http_header_value(request_head, "Accept-Encoding", value, sizeof(value))) return 0;
+
+    for (char *tok = strtok(value, ","); tok; tok = strtok(NULL, ",")) {
+        while (*tok == ' ') tok++;
+        if (strncasecmp(tok, "gzip", 4) != 0 || (tok[4] != '\0' && tok[4] != ';' && tok[4] != ' ')) continue;
+        char *q = strstr(tok, "q=");
+        return !q || atof(q + 2) > 0;
+    }
+    return 0;
+}
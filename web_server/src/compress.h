@@ -0,0 +1,13 @@
+#ifndef compress_h
+#define compress_h
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+int gzip_compress(const void *data, size_t size, int level, void **out, size_t *out_size);
+int accepts_gzip(const char *request_head);
+int gzip_cache_init(const char *dir);
+int gzip_cache_open(const char *rel, const struct stat *st, struct stat *gz_st);
+int gzip_cache_store(const char *rel, const struct stat *st, const void *data, size_t size);
+
+#endif
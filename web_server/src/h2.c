@@ -0,0 +1,778 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "server.h"
+#include "h2.h"
+#include "hpack.h"
+
+/* HTTP/2 over cleartext TCP. The worker that owns the connection runs the frame
+   loop; every stream is handed to a forked child through a socketpair and served
+   by the regular HTTP/1.1 handlers. The loop turns the child's HTTP/1.1 response
+   back into HEADERS and DATA frames and applies flow control in both directions. */
+
+static const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+#define PREFACE_LEN 24
+
+enum { FRAME_DATA = 0, FRAME_HEADERS, FRAME_PRIORITY, FRAME_RST_STREAM, FRAME_SETTINGS,
+       FRAME_PUSH_PROMISE, FRAME_PING, FRAME_GOAWAY, FRAME_WINDOW_UPDATE, FRAME_CONTINUATION };
+
+enum { FLAG_END_STREAM = 0x1, FLAG_ACK = 0x1, FLAG_END_HEADERS = 0x4, FLAG_PADDED = 0x8, FLAG_PRIORITY = 0x20 };
+
+enum { H2_NO_ERROR = 0, H2_PROTOCOL_ERROR, H2_INTERNAL_ERROR, H2_FLOW_CONTROL_ERROR, H2_SETTINGS_TIMEOUT,
+       H2_STREAM_CLOSED, H2_FRAME_SIZE_ERROR, H2_REFUSED_STREAM, H2_CANCEL, H2_COMPRESSION_ERROR };
+
+enum { SETTINGS_HEADER_TABLE_SIZE = 1, SETTINGS_ENABLE_PUSH, SETTINGS_MAX_CONCURRENT_STREAMS,
+       SETTINGS_INITIAL_WINDOW_SIZE, SETTINGS_MAX_FRAME_SIZE, SETTINGS_MAX_HEADER_LIST_SIZE };
+
+typedef enum { CHUNK_SIZE = 0, CHUNK_EXTENSION, CHUNK_DATA, CHUNK_DATA_END, CHUNK_DONE } ChunkState;
+
+typedef struct {
+    uint32_t id;
+    int fd;
+    int32_t send_window;
+    int remote_closed;
+    int write_shut;
+    int eof;
+    int headers_sent;
+    int chunked;
+    ChunkState chunk_state;
+    size_t chunk_left;
+    char head[H2_RESPONSE_HEAD_MAX];
+    size_t head_len;
+    uint8_t out[H2_FRAME_MAX];
+    size_t out_len;
+    size_t out_off;
+    uint8_t *in;
+    size_t in_len;
+} H2Stream;
+
+typedef struct {
+    struct Server *server;
+    int fd;
+    const struct sockaddr_storage *peer;
+    H2Stream streams[H2_MAX_STREAMS];
+    int active;
+    int32_t send_window;
+    int32_t peer_initial_window;
+    uint32_t peer_max_frame;
+    uint32_t last_stream_id;
+    int goaway;
+    int failed;
+    int preface_done;
+    HpackDecoder decoder;
+    uint8_t rbuf[9 + H2_FRAME_MAX];
+    size_t rlen;
+    uint8_t block[H2_HEADER_BLOCK_MAX];
+    size_t block_len;
+    uint32_t block_stream;
+    uint8_t block_flags;
+} H2Conn;
+
+/* One connection per worker, so the state lives in the worker's own copy of .bss. */
+static H2Conn h2_conn;
+static uint8_t frame_buffer[9 + H2_FRAME_MAX];
+static HpackHeader decoded_headers[64];
+static char decoded_scratch[2 * H2_HEADER_BLOCK_MAX];
+
+int h2_is_preface(const char *buffer, size_t len) {
+    return len >= 16 && memcmp(buffer, PREFACE, 16) == 0;
+}
+
+int h2_wants_upgrade(const char *head) {
+    char value[64];
+    if (!http_header_value(head, "Upgrade", value, sizeof(value)) || strcasecmp(value, "h2c") != 0) return 0;
+    if (!http_header_value(head, "HTTP2-Settings", value, sizeof(value))) return 0;
+    /* A request body would have to be read before switching; keep those on HTTP/1.1. */
+    if (http_header_value(head, "Content-Length", value, sizeof(value)) && atol(value) > 0) return 0;
+    return !http_header_value(head, "Transfer-Encoding", value, sizeof(value));
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static int send_frame(H2Conn *c, uint8_t type, uint8_t flags, uint32_t stream, const void *payload, size_t len) {
+    frame_buffer[0] = len >> 16;
+    frame_buffer[1] = len >> 8;
+    frame_buffer[2] = len;
+    frame_buffer[3] = type;
+    frame_buffer[4] = flags;
+    write_u32(frame_buffer + 5, stream & 0x7fffffff);
+    if (len) memcpy(frame_buffer + 9, payload, len);
+    if (write_all(c->fd, frame_buffer, 9 + len) < 0) {
+        c->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static void send_goaway(H2Conn *c, uint32_t error) {
+    uint8_t payload[8];
+    write_u32(payload, c->last_stream_id);
+    write_u32(payload + 4, error);
+    send_frame(c, FRAME_GOAWAY, 0, 0, payload, sizeof(payload));
+    if (error != H2_NO_ERROR) c->failed = 1;
+    c->goaway = 1;
+}
+
+static void send_rst(H2Conn *c, uint32_t stream, uint32_t error) {
+    uint8_t payload[4];
+    write_u32(payload, error);
+    send_frame(c, FRAME_RST_STREAM, 0, stream, payload, sizeof(payload));
+}
+
+static void send_window_update(H2Conn *c, uint32_t stream, uint32_t increment) {
+    uint8_t payload[4];
+    if (increment == 0) return;
+    write_u32(payload, increment);
+    send_frame(c, FRAME_WINDOW_UPDATE, 0, stream, payload, sizeof(payload));
+}
+
+static H2Stream *find_stream(H2Conn *c, uint32_t id) {
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (c->streams[i].id == id) return &c->streams[i];
+    }
+    return NULL;
+}
+
+static void close_stream(H2Conn *c, H2Stream *s) {
+    if (s->fd >= 0) close(s->fd);
+    free(s->in);
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+    c->active--;
+}
+
+/* RFC 9113 §8.2.1: names are lowercase tokens and no value may carry CR, LF or NUL.
+   Anything else would let a client smuggle extra lines into the HTTP/1.1 head. */
+static int valid_field(const HpackHeader *h) {
+    if (h->name_len == 0) return 0;
+    for (size_t k = h->name[0] == ':' ? 1 : 0; k < h->name_len; k++) {
+        unsigned char ch = h->name[k];
+        if (ch <= 0x20 || ch >= 0x7f || ch == ':' || (ch >= 'A' && ch <= 'Z')) return 0;
+    }
+    for (size_t k = 0; k < h->value_len; k++) {
+        unsigned char ch = h->value[k];
+        if (ch == '\0' || ch == '\r' || ch == '\n') return 0;
+    }
+    return 1;
+}
+
+/* Builds the HTTP/1.1 request head the handlers expect from the decoded pseudo-headers.
+   Returns -1 for a malformed request, which the caller resets with PROTOCOL_ERROR. */
+static int build_request_head(const HpackHeader *headers, int count, char *out, size_t size) {
+    const char *method = NULL, *path = NULL, *authority = NULL;
+    for (int i = 0; i < count; i++) {
+        if (!valid_field(&headers[i])) return -1;
+        if (strcmp(headers[i].name, ":method") == 0) method = headers[i].value;
+        else if (strcmp(headers[i].name, ":path") == 0) path = headers[i].value;
+        else if (strcmp(headers[i].name, ":authority") == 0) authority = headers[i].value;
+    }
+    if (!method || !path || path[0] == '\0') return -1;
+    if (strpbrk(method, " \t") || strpbrk(path, " \t") || (authority && strpbrk(authority, " \t"))) return -1;
+
+    size_t len = snprintf(out, size, "%s %s HTTP/1.1\r\n", method, path);
+    if (authority && len < size) len += snprintf(out + len, size - len, "Host: %s\r\n", authority);
+
+    for (int i = 0; i < count && len < size; i++) {
+        const char *name = headers[i].name;
+        if (name[0] == ':' || strcmp(name, "connection") == 0 || (authority && strcmp(name, "host") == 0)) continue;
+        if (headers[i].name_len + headers[i].value_len + 4 >= size - len) return -1;
+        /* Handlers match a few headers case-sensitively, so restore HTTP/1.1 casing. */
+        for (size_t k = 0; k < headers[i].name_len; k++) {
+            out[len++] = (k == 0 || name[k - 1] == '-') ? toupper((unsigned char)name[k]) : name[k];
+        }
+        len += snprintf(out + len, size - len, ": %s\r\n", headers[i].value);
+    }
+    if (len + 3 > size) return -1;
+    memcpy(out + len, "\r\n", 3);
+    return len + 2;
+}
+
+static int open_stream(H2Conn *c, uint32_t id, char *head, size_t head_len, int remote_closed) {
+    H2Stream *s = find_stream(c, 0);
+    int pair[2];
+    if (!s || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pair[0]);
+        close(pair[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(c->fd);
+        close(pair[0]);
+        for (int i = 0; i < H2_MAX_STREAMS; i++) {
+            if (c->streams[i].fd >= 0) close(c->streams[i].fd);
+        }
+        serve_buffered_request(c->server, pair[1], head, head_len, c->peer);
+        close(pair[1]);
+        exit(0);
+    }
+
+    close(pair[1]);
+    fcntl(pair[0], F_SETFL, O_NONBLOCK);
+    s->id = id;
+    s->fd = pair[0];
+    s->send_window = c->peer_initial_window;
+    s->remote_closed = remote_closed;
+    c->active++;
+    return 0;
+}
+
+static void process_header_block(H2Conn *c, uint32_t id, uint8_t flags, const uint8_t *block, size_t len) {
+    int count = hpack_decode(&c->decoder, block, len, decoded_headers,
+                             sizeof(decoded_headers) / sizeof(decoded_headers[0]),
+                             decoded_scratch, sizeof(decoded_scratch));
+    if (count < 0) {
+        send_goaway(c, H2_COMPRESSION_ERROR);
+        return;
+    }
+
+    H2Stream *s = find_stream(c, id);
+    if (s) {
+        /* Trailers: nothing to forward, but they end the request body. */
+        if (!(flags & FLAG_END_STREAM)) send_goaway(c, H2_PROTOCOL_ERROR);
+        s->remote_closed = 1;
+        return;
+    }
+    if (id % 2 == 0 || id <= c->last_stream_id) {
+        send_goaway(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    c->last_stream_id = id;
+    if (c->goaway) return;
+
+    char head[BUFFER_SIZE];
+    int head_len = build_request_head(decoded_headers, count, head, sizeof(head));
+    if (head_len < 0) {
+        send_rst(c, id, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (c->active >= H2_MAX_STREAMS || open_stream(c, id, head, head_len, flags & FLAG_END_STREAM) < 0) {
+        send_rst(c, id, H2_REFUSED_STREAM);
+    }
+}
+
+static int frame_payload(uint8_t flags, const uint8_t **payload, size_t *len, int priority) {
+    if (flags & FLAG_PADDED) {
+        if (*len < 1 || (*payload)[0] >= *len) return -1;
+        uint8_t pad = (*payload)[0];
+        (*payload)++;
+        *len -= 1 + pad;
+    }
+    if (priority && (flags & FLAG_PRIORITY)) {
+        if (*len < 5) return -1;
+        *payload += 5;
+        *len -= 5;
+    }
+    return 0;
+}
+
+static void handle_data(H2Conn *c, uint32_t id, uint8_t flags, const uint8_t *payload, size_t frame_len) {
+    size_t len = frame_len;
+    if (frame_payload(flags, &payload, &len, 0) < 0) {
+        send_goaway(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    H2Stream *s = id ? find_stream(c, id) : NULL;
+    if (!s || s->remote_closed) {
+        if (id == 0 || id > c->last_stream_id) {
+            send_goaway(c, H2_PROTOCOL_ERROR);
+            return;
+        }
+        send_window_update(c, 0, frame_len);
+        send_rst(c, id, H2_STREAM_CLOSED);
+        return;
+    }
+
+    /* Padding is never forwarded, so its credit comes back at once. */
+    send_window_update(c, 0, frame_len - len);
+    send_window_update(c, id, frame_len - len);
+
+    if (s->in_len + len > H2_WINDOW_DEFAULT) {
+        send_goaway(c, H2_FLOW_CONTROL_ERROR);
+        return;
+    }
+    if (len) {
+        if (!s->in && !(s->in = malloc(H2_WINDOW_DEFAULT))) {
+            send_goaway(c, H2_INTERNAL_ERROR);
+            return;
+        }
+        memcpy(s->in + s->in_len, payload, len);
+        s->in_len += len;
+    }
+    if (flags & FLAG_END_STREAM) s->remote_closed = 1;
+}
+
+static void apply_setting(H2Conn *c, uint16_t id, uint32_t value) {
+    if (id == SETTINGS_INITIAL_WINDOW_SIZE) {
+        if (value > 0x7fffffff) {
+            send_goaway(c, H2_FLOW_CONTROL_ERROR);
+            return;
+        }
+        int32_t delta = (int32_t)value - c->peer_initial_window;
+        c->peer_initial_window = value;
+        for (int i = 0; i < H2_MAX_STREAMS; i++) {
+            if (c->streams[i].id) c->streams[i].send_window += delta;
+        }
+    } else if (id == SETTINGS_MAX_FRAME_SIZE) {
+        if (value < 16384 || value > 16777215) {
+            send_goaway(c, H2_PROTOCOL_ERROR);
+            return;
+        }
+        c->peer_max_frame = value < H2_FRAME_MAX ? value : H2_FRAME_MAX;
+    }
+}
+
+static void handle_settings(H2Conn *c, uint32_t id, uint8_t flags, const uint8_t *payload, size_t len) {
+    if (id != 0) {
+        send_goaway(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (flags & FLAG_ACK) return;
+    if (len % 6) {
+        send_goaway(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+    for (size_t i = 0; i < len; i += 6) {
+        apply_setting(c, (payload[i] << 8) | payload[i + 1], read_u32(payload + i + 2));
+    }
+    send_frame(c, FRAME_SETTINGS, FLAG_ACK, 0, NULL, 0);
+}
+
+static void handle_window_update(H2Conn *c, uint32_t id, const uint8_t *payload, size_t len) {
+    if (len != 4) {
+        send_goaway(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+    uint32_t increment = read_u32(payload) & 0x7fffffff;
+    if (id == 0) {
+        if (increment == 0 || (int64_t)c->send_window + increment > 0x7fffffff) {
+            send_goaway(c, increment ? H2_FLOW_CONTROL_ERROR : H2_PROTOCOL_ERROR);
+            return;
+        }
+        c->send_window += increment;
+        return;
+    }
+    H2Stream *s = find_stream(c, id);
+    if (!s) return;
+    if (increment == 0 || (int64_t)s->send_window + increment > 0x7fffffff) {
+        send_rst(c, id, increment ? H2_FLOW_CONTROL_ERROR : H2_PROTOCOL_ERROR);
+        close_stream(c, s);
+        return;
+    }
+    s->send_window += increment;
+}
+
+static void handle_frame(H2Conn *c, uint8_t type, uint8_t flags, uint32_t id, const uint8_t *payload, size_t len) {
+    if (c->block_len && (type != FRAME_CONTINUATION || id != c->block_stream)) {
+        send_goaway(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    switch (type) {
+    case FRAME_DATA:
+        handle_data(c, id, flags, payload, len);
+        break;
+    case FRAME_HEADERS:
+        if (id == 0 || frame_payload(flags, &payload, &len, 1) < 0) {
+            send_goaway(c, H2_PROTOCOL_ERROR);
+            break;
+        }
+        if (flags & FLAG_END_HEADERS) {
+            process_header_block(c, id, flags, payload, len);
+            break;
+        }
+        memcpy(c->block, payload, len);
+        c->block_len = len;
+        c->block_stream = id;
+        c->block_flags = flags;
+        break;
+    case FRAME_CONTINUATION:
+        if (!c->block_len || c->block_len + len > sizeof(c->block)) {
+            send_goaway(c, c->block_len ? H2_INTERNAL_ERROR : H2_PROTOCOL_ERROR);
+            break;
+        }
+        memcpy(c->block + c->block_len, payload, len);
+        c->block_len += len;
+        if (flags & FLAG_END_HEADERS) {
+            size_t block_len = c->block_len;
+            c->block_len = 0;
+            process_header_block(c, id, c->block_flags, c->block, block_len);
+        }
+        break;
+    case FRAME_RST_STREAM: {
+        H2Stream *s = id ? find_stream(c, id) : NULL;
+        if (s) close_stream(c, s);
+        break;
+    }
+    case FRAME_SETTINGS:
+        handle_settings(c, id, flags, payload, len);
+        break;
+    case FRAME_PING:
+        if (len != 8) send_goaway(c, H2_FRAME_SIZE_ERROR);
+        else if (!(flags & FLAG_ACK)) send_frame(c, FRAME_PING, FLAG_ACK, 0, payload, len);
+        break;
+    case FRAME_GOAWAY:
+        c->goaway = 1;
+        break;
+    case FRAME_WINDOW_UPDATE:
+        handle_window_update(c, id, payload, len);
+        break;
+    case FRAME_PUSH_PROMISE:
+        send_goaway(c, H2_PROTOCOL_ERROR);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Consumes every complete frame in rbuf. */
+static void process_input(H2Conn *c) {
+    size_t off = 0;
+    if (!c->preface_done) {
+        if (c->rlen < PREFACE_LEN) return;
+        if (memcmp(c->rbuf, PREFACE, PREFACE_LEN) != 0) {
+            c->failed = 1;
+            return;
+        }
+        c->preface_done = 1;
+        off = PREFACE_LEN;
+    }
+
+    while (!c->failed && c->rlen - off >= 9) {
+        const uint8_t *h = c->rbuf + off;
+        size_t len = (h[0] << 16) | (h[1] << 8) | h[2];
+        if (len > H2_FRAME_MAX) {
+            send_goaway(c, H2_FRAME_SIZE_ERROR);
+            break;
+        }
+        if (c->rlen - off < 9 + len) break;
+        handle_frame(c, h[3], h[4], read_u32(h + 5) & 0x7fffffff, h + 9, len);
+        off += 9 + len;
+    }
+    memmove(c->rbuf, c->rbuf + off, c->rlen - off);
+    c->rlen -= off;
+}
+
+static int is_hop_header(const char *name) {
+    return strcmp(name, "connection") == 0 || strcmp(name, "keep-alive") == 0 ||
+           strcmp(name, "transfer-encoding") == 0 || strcmp(name, "upgrade") == 0 ||
+           strcmp(name, "proxy-connection") == 0;
+}
+
+static int send_response_headers(H2Conn *c, H2Stream *s) {
+    uint8_t block[2 * H2_RESPONSE_HEAD_MAX];
+    char status[4];
+    int code;
+    if (sscanf(s->head, "HTTP/%*s %3d", &code) != 1 || code < 100 || code > 999) return -1;
+    snprintf(status, sizeof(status), "%d", code);
+    size_t n = hpack_encode(block, sizeof(block), ":status", status);
+
+    char *line = strstr(s->head, "\r\n");
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        char *eol = strstr(line, "\r\n");
+        char *colon = memchr(line, ':', eol - line);
+        if (colon) {
+            char name[64];
+            size_t name_len = colon - line < (long)sizeof(name) - 1 ? (size_t)(colon - line) : sizeof(name) - 1;
+            for (size_t i = 0; i < name_len; i++) name[i] = tolower((unsigned char)line[i]);
+            name[name_len] = '\0';
+
+            char *value = colon + 1;
+            while (*value == ' ') value++;
+            char saved = *eol;
+            *eol = '\0';
+            if (strcmp(name, "transfer-encoding") == 0 && strstr(value, "chunked")) s->chunked = 1;
+            if (!is_hop_header(name)) {
+                size_t m = hpack_encode(block + n, sizeof(block) - n, name, value);
+                if (m == 0) return -1;
+                n += m;
+            }
+            *eol = saved;
+        }
+        line = eol;
+    }
+
+    size_t off = 0;
+    int type = FRAME_HEADERS;
+    while (1) {
+        size_t chunk = n - off > c->peer_max_frame ? c->peer_max_frame : n - off;
+        int last = off + chunk == n;
+        if (send_frame(c, type, last ? FLAG_END_HEADERS : 0, s->id, block + off, chunk) < 0) return -1;
+        off += chunk;
+        type = FRAME_CONTINUATION;
+        if (last) break;
+    }
+    s->headers_sent = 1;
+    return 0;
+}
+
+/* Appends response body bytes to s->out, removing chunked framing when present. */
+static void feed_body(H2Stream *s, const char *in, size_t len) {
+    if (!s->chunked) {
+        memcpy(s->out + s->out_len, in, len);
+        s->out_len += len;
+        return;
+    }
+    for (size_t i = 0; i < len;) {
+        switch (s->chunk_state) {
+        case CHUNK_SIZE:
+            if (in[i] == '\n') {
+                s->chunk_state = s->chunk_left ? CHUNK_DATA : CHUNK_DONE;
+            } else if (in[i] == ';') {
+                s->chunk_state = CHUNK_EXTENSION;
+            } else if (isxdigit((unsigned char)in[i])) {
+                int d = isdigit((unsigned char)in[i]) ? in[i] - '0' : (tolower((unsigned char)in[i]) - 'a' + 10);
+                s->chunk_left = s->chunk_left * 16 + d;
+            }
+            i++;
+            break;
+        case CHUNK_DATA: {
+            size_t n = len - i < s->chunk_left ? len - i : s->chunk_left;
+            memcpy(s->out + s->out_len, in + i, n);
+            s->out_len += n;
+            s->chunk_left -= n;
+            i += n;
+            if (s->chunk_left == 0) s->chunk_state = CHUNK_DATA_END;
+            break;
+        }
+        case CHUNK_EXTENSION:
+            if (in[i] == '\n') s->chunk_state = s->chunk_left ? CHUNK_DATA : CHUNK_DONE;
+            i++;
+            break;
+        case CHUNK_DATA_END:
+            if (in[i] == '\n') s->chunk_state = CHUNK_SIZE;
+            i++;
+            break;
+        case CHUNK_DONE:
+            return;
+        }
+    }
+}
+
+static void flush_data(H2Conn *c, H2Stream *s) {
+    while (s->out_off < s->out_len && !c->failed) {
+        int64_t n = s->out_len - s->out_off;
+        if (n > s->send_window) n = s->send_window;
+        if (n > c->send_window) n = c->send_window;
+        if (n > c->peer_max_frame) n = c->peer_max_frame;
+        if (n <= 0) return;
+        send_frame(c, FRAME_DATA, 0, s->id, s->out + s->out_off, n);
+        s->out_off += n;
+        s->send_window -= n;
+        c->send_window -= n;
+    }
+    s->out_off = s->out_len = 0;
+}
+
+/* Reads what the stream's worker has written so far and forwards it. */
+static void pump_response(H2Conn *c, H2Stream *s) {
+    if (s->out_off < s->out_len) return;
+
+    ssize_t n;
+    if (!s->headers_sent) {
+        n = read(s->fd, s->head + s->head_len, sizeof(s->head) - 1 - s->head_len);
+        if (n > 0) {
+            s->head_len += n;
+            s->head[s->head_len] = '\0';
+            char *end = strstr(s->head, "\r\n\r\n");
+            if (end) {
+                if (send_response_headers(c, s) < 0) {
+                    send_rst(c, s->id, H2_INTERNAL_ERROR);
+                    close_stream(c, s);
+                    return;
+                }
+                size_t head_size = end + 4 - s->head;
+                feed_body(s, s->head + head_size, s->head_len - head_size);
+            } else if (s->head_len == sizeof(s->head) - 1) {
+                n = 0;
+            }
+        }
+    } else {
+        char raw[H2_FRAME_MAX];
+        n = read(s->fd, raw, sizeof(raw));
+        if (n > 0) feed_body(s, raw, n);
+    }
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        if (!s->headers_sent) {
+            send_rst(c, s->id, H2_INTERNAL_ERROR);
+            close_stream(c, s);
+            return;
+        }
+        s->eof = 1;
+    }
+    flush_data(c, s);
+}
+
+static void push_request_body(H2Conn *c, H2Stream *s) {
+    ssize_t n = write(s->fd, s->in, s->in_len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n < 0) {
+        /* The handler is gone; discard the body but keep the connection window whole. */
+        send_window_update(c, 0, s->in_len);
+        s->in_len = 0;
+        return;
+    }
+    memmove(s->in, s->in + n, s->in_len - n);
+    s->in_len -= n;
+    send_window_update(c, 0, n);
+    if (!s->remote_closed) send_window_update(c, s->id, n);
+}
+
+/* Runs after every poll round: moves buffered bytes and retires finished streams. */
+static void service_streams(H2Conn *c) {
+    for (int i = 0; i < H2_MAX_STREAMS && !c->failed; i++) {
+        H2Stream *s = &c->streams[i];
+        if (!s->id) continue;
+
+        if (s->remote_closed && s->in_len == 0 && !s->write_shut) {
+            shutdown(s->fd, SHUT_WR);
+            s->write_shut = 1;
+        }
+        if (s->out_off < s->out_len) flush_data(c, s);
+        if (s->eof && s->out_off == s->out_len) {
+            send_frame(c, FRAME_DATA, FLAG_END_STREAM, s->id, NULL, 0);
+            if (!s->remote_closed) send_rst(c, s->id, H2_NO_ERROR);
+            close_stream(c, s);
+        }
+    }
+}
+
+static int base64url_decode(const char *in, uint8_t *out, size_t size) {
+    size_t n = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (; *in && *in != '='; in++) {
+        const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        const char *p = strchr(alphabet, *in);
+        if (!p) return -1;
+        acc = (acc << 6) | (p - alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (n >= size) return -1;
+            out[n++] = acc >> bits;
+        }
+    }
+    return n;
+}
+
+static void start_upgrade(H2Conn *c, const char *head) {
+    char encoded[256];
+    uint8_t settings[192];
+    if (http_header_value(head, "HTTP2-Settings", encoded, sizeof(encoded))) {
+        int len = base64url_decode(encoded, settings, sizeof(settings));
+        for (int i = 0; i + 6 <= len; i += 6) {
+            apply_setting(c, (settings[i] << 8) | settings[i + 1], read_u32(settings + i + 2));
+        }
+    }
+
+    static const char SWITCHING[] =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Connection: Upgrade\r\n"
+        "Upgrade: h2c\r\n"
+        "\r\n";
+    if (write_all(c->fd, SWITCHING, sizeof(SWITCHING) - 1) < 0) {
+        c->failed = 1;
+        return;
+    }
+    c->last_stream_id = 1;
+}
+
+void h2_serve(struct Server *server, int socket, const struct sockaddr_storage *peer,
+              const char *initial, size_t initial_len, char *upgrade_head, size_t upgrade_len) {
+    H2Conn *c = &h2_conn;
+    memset(c, 0, sizeof(*c));
+    c->server = server;
+    c->fd = socket;
+    c->peer = peer;
+    c->send_window = H2_WINDOW_DEFAULT;
+    c->peer_initial_window = H2_WINDOW_DEFAULT;
+    c->peer_max_frame = H2_FRAME_MAX;
+    for (int i = 0; i < H2_MAX_STREAMS; i++) c->streams[i].fd = -1;
+    hpack_decoder_init(&c->decoder);
+
+    if (upgrade_head) start_upgrade(c, upgrade_head);
+
+    uint8_t settings[6] = { 0, SETTINGS_MAX_CONCURRENT_STREAMS };
+    write_u32(settings + 2, H2_MAX_STREAMS);
+    send_frame(c, FRAME_SETTINGS, 0, 0, settings, sizeof(settings));
+
+    if (upgrade_head && !c->failed && open_stream(c, 1, upgrade_head, upgrade_len, 1) < 0)
+        send_rst(c, 1, H2_REFUSED_STREAM);
+
+    if (initial_len > sizeof(c->rbuf)) initial_len = sizeof(c->rbuf);
+    memcpy(c->rbuf, initial, initial_len);
+    c->rlen = initial_len;
+
+    LOG_INFO("[PID:%d] HTTP/2 connection%s", getpid(), upgrade_head ? " (upgraded)" : "");
+
+    struct pollfd fds[1 + H2_MAX_STREAMS];
+    H2Stream *polled[1 + H2_MAX_STREAMS];
+    while (!c->failed) {
+        process_input(c);
+        service_streams(c);
+        if (c->failed || (c->goaway && c->active == 0)) break;
+
+        int nfds = 0;
+        fds[nfds++] = (struct pollfd){ .fd = c->fd, .events = c->rlen < sizeof(c->rbuf) ? POLLIN : 0 };
+        for (int i = 0; i < H2_MAX_STREAMS; i++) {
+            H2Stream *s = &c->streams[i];
+            if (!s->id) continue;
+            short events = 0;
+            if (!s->eof && s->out_off == s->out_len && (!s->headers_sent || (s->send_window > 0 && c->send_window > 0)))
+                events |= POLLIN;
+            if (s->in_len) events |= POLLOUT;
+            if (!events) continue;
+            polled[nfds] = s;
+            fds[nfds++] = (struct pollfd){ .fd = s->fd, .events = events };
+        }
+
+        int ready = poll(fds, nfds, c->active ? -1 : server->config.keep_alive_timeout * 1000);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            send_goaway(c, H2_NO_ERROR);
+            break;
+        }
+
+        if (fds[0].revents) {
+            ssize_t n = read(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - c->rlen);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            c->rlen += n;
+        }
+        for (int i = 1; i < nfds && !c->failed; i++) {
+            H2Stream *s = polled[i];
+            if (!s->id) continue;
+            if (fds[i].revents & POLLOUT) push_request_body(c, s);
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) pump_response(c, s);
+        }
+    }
+
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (c->streams[i].id) close_stream(c, &c->streams[i]);
+    }
+    hpack_decoder_free(&c->decoder);
+}
@@ -0,0 +1,20 @@
+#ifndef h2_h
+#define h2_h
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+#define H2_MAX_STREAMS 32
+#define H2_FRAME_MAX 16384
+#define H2_WINDOW_DEFAULT 65535
+#define H2_HEADER_BLOCK_MAX 16384
+#define H2_RESPONSE_HEAD_MAX 4096
+
+struct Server;
+
+int h2_is_preface(const char *buffer, size_t len);
+int h2_wants_upgrade(const char *head);
+void h2_serve(struct Server *server, int socket, const struct sockaddr_storage *peer,
+              const char *initial, size_t initial_len, char *upgrade_head, size_t upgrade_len);
+
+#endif
@@ -0,0 +1,336 @@
+#include <stdlib.h>
+#include <string.h>
+#include "hpack.h"
+
+static const struct {
+    const char *name;
+    const char *value;
+} STATIC_TABLE[61] = {
+    { ":authority", "" }, { ":method", "GET" }, { ":method", "POST" }, { ":path", "/" },
+    { ":path", "/index.html" }, { ":scheme", "http" }, { ":scheme", "https" }, { ":status", "200" },
+    { ":status", "204" }, { ":status", "206" }, { ":status", "304" }, { ":status", "400" },
+    { ":status", "404" }, { ":status", "500" }, { "accept-charset", "" }, { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" }, { "accept-ranges", "" }, { "accept", "" }, { "access-control-allow-origin", "" },
+    { "age", "" }, { "allow", "" }, { "authorization", "" }, { "cache-control", "" },
+    { "content-disposition", "" }, { "content-encoding", "" }, { "content-language", "" }, { "content-length", "" },
+    { "content-location", "" }, { "content-range", "" }, { "content-type", "" }, { "cookie", "" },
+    { "date", "" }, { "etag", "" }, { "expect", "" }, { "expires", "" },
+    { "from", "" }, { "host", "" }, { "if-match", "" }, { "if-modified-since", "" },
+    { "if-none-match", "" }, { "if-range", "" }, { "if-unmodified-since", "" }, { "last-modified", "" },
+    { "link", "" }, { "location", "" }, { "max-forwards", "" }, { "proxy-authenticate", "" },
+    { "proxy-authorization", "" }, { "range", "" }, { "referer", "" }, { "refresh", "" },
+    { "retry-after", "" }, { "server", "" }, { "set-cookie", "" }, { "strict-transport-security", "" },
+    { "transfer-encoding", "" }, { "user-agent", "" }, { "vary", "" }, { "via", "" },
+    { "www-authenticate", "" },
+};
+
+/* RFC 7541 Appendix B; symbol 256 is EOS. */
+static const uint32_t HUFFMAN_CODES[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+static const uint8_t HUFFMAN_LENGTHS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+/* Binary decoding trie built from the table on first use. A child value >= 0 is
+   the next node, a negative one is a leaf holding -(symbol + 1). */
+static short huffman_trie[512][2];
+static int huffman_nodes = 0;
+
+static void huffman_build(void) {
+    huffman_nodes = 1;
+    for (int sym = 0; sym < 257; sym++) {
+        int node = 0;
+        for (int bit = HUFFMAN_LENGTHS[sym] - 1; bit >= 0; bit--) {
+            int b = (HUFFMAN_CODES[sym] >> bit) & 1;
+            if (bit == 0) {
+                huffman_trie[node][b] = -(sym + 1);
+            } else {
+                if (huffman_trie[node][b] == 0) huffman_trie[node][b] = huffman_nodes++;
+                node = huffman_trie[node][b];
+            }
+        }
+    }
+}
+
+/* Returns the decoded length, or -1 on EOS, overlong or non-EOS padding. */
+static long huffman_decode(const uint8_t *in, size_t len, char *out, size_t size) {
+    if (!huffman_nodes) huffman_build();
+
+    size_t n = 0;
+    int node = 0, depth = 0, ones = 1;
+    for (size_t i = 0; i < len; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            int b = (in[i] >> bit) & 1;
+            short next = huffman_trie[node][b];
+            ones &= b;
+            depth++;
+            if (next < 0) {
+                if (next == -257 || n >= size) return -1;
+                out[n++] = (char)(-next - 1);
+                node = 0;
+                depth = 0;
+                ones = 1;
+            } else {
+                node = next;
+            }
+        }
+    }
+    if (depth > 7 || !ones) return -1;
+    return n;
+}
+
+static int decode_int(const uint8_t **p, const uint8_t *end, int prefix, uint32_t *out) {
+    if (*p >= end) return -1;
+    uint32_t mask = (1u << prefix) - 1;
+    uint32_t value = *(*p)++ & mask;
+    if (value == mask) {
+        for (int shift = 0;; shift += 7) {
+            if (*p >= end || shift > 21) return -1;
+            uint8_t b = *(*p)++;
+            value += (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) break;
+        }
+    }
+    *out = value;
+    return 0;
+}
+
+/* Appends a string literal to scratch and NUL-terminates it. */
+static const char *decode_string(const uint8_t **p, const uint8_t *end, char **scratch, size_t *left, size_t *out_len) {
+    if (*p >= end) return NULL;
+    int huffman = **p & 0x80;
+    uint32_t len;
+    if (decode_int(p, end, 7, &len) < 0 || len > (size_t)(end - *p) || *left == 0) return NULL;
+
+    char *s = *scratch;
+    long n;
+    if (huffman) {
+        n = huffman_decode(*p, len, s, *left - 1);
+    } else {
+        n = len < *left ? (long)len : -1;
+        if (n >= 0) memcpy(s, *p, len);
+    }
+    if (n < 0) return NULL;
+    s[n] = '\0';
+    *p += len;
+    *scratch += n + 1;
+    *left -= n + 1;
+    *out_len = n;
+    return s;
+}
+
+void hpack_decoder_init(HpackDecoder *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->max_size = HPACK_TABLE_SIZE;
+}
+
+static void table_evict(HpackDecoder *decoder, size_t max_size) {
+    while (decoder->count > 0 && decoder->size > max_size) {
+        HpackEntry *oldest = &decoder->entries[(decoder->head + decoder->count - 1) % HPACK_MAX_ENTRIES];
+        decoder->size -= oldest->name_len + oldest->value_len + 32;
+        free(oldest->data);
+        oldest->data = NULL;
+        decoder->count--;
+    }
+}
+
+void hpack_decoder_free(HpackDecoder *decoder) {
+    table_evict(decoder, 0);
+}
+
+static void table_insert(HpackDecoder *decoder, const HpackHeader *h) {
+    size_t entry_size = h->name_len + h->value_len + 32;
+    if (entry_size > decoder->max_size) {
+        table_evict(decoder, 0);
+        return;
+    }
+    table_evict(decoder, decoder->max_size - entry_size);
+
+    char *data = malloc(h->name_len + h->value_len + 2);
+    if (!data) return;
+    memcpy(data, h->name, h->name_len + 1);
+    memcpy(data + h->name_len + 1, h->value, h->value_len + 1);
+
+    decoder->head = (decoder->head + HPACK_MAX_ENTRIES - 1) % HPACK_MAX_ENTRIES;
+    decoder->entries[decoder->head] = (HpackEntry){ data, h->name_len, h->value_len };
+    decoder->count++;
+    decoder->size += entry_size;
+}
+
+/* Index 1..61 is the static table, 62 and up the dynamic one, newest first. */
+static int table_get(const HpackDecoder *decoder, uint32_t index, const char **name, size_t *name_len,
+                     const char **value, size_t *value_len) {
+    if (index >= 1 && index <= 61) {
+        *name = STATIC_TABLE[index - 1].name;
+        *value = STATIC_TABLE[index - 1].value;
+        *name_len = strlen(*name);
+        *value_len = strlen(*value);
+        return 0;
+    }
+    if (index < 62 || index - 62 >= (uint32_t)decoder->count) return -1;
+    const HpackEntry *e = &decoder->entries[(decoder->head + index - 62) % HPACK_MAX_ENTRIES];
+    *name = e->data;
+    *name_len = e->name_len;
+    *value = e->data + e->name_len + 1;
+    *value_len = e->value_len;
+    return 0;
+}
+
+static const char *copy_string(const char *s, size_t len, char **scratch, size_t *left) {
+    if (len + 1 > *left) return NULL;
+    char *out = *scratch;
+    memcpy(out, s, len);
+    out[len] = '\0';
+    *scratch += len + 1;
+    *left -= len + 1;
+    return out;
+}
+
+/* Decodes one complete header block. Returns the number of headers, or -1 on a
+   compression error, after which the connection must be torn down. */
+int hpack_decode(HpackDecoder *decoder, const uint8_t *in, size_t len,
+                 HpackHeader *headers, int max_headers, char *scratch, size_t scratch_size) {
+    const uint8_t *p = in, *end = in + len;
+    int count = 0;
+
+    while (p < end) {
+        uint8_t first = *p;
+        uint32_t index;
+
+        if ((first & 0xe0) == 0x20) {
+            if (decode_int(&p, end, 5, &index) < 0 || index > HPACK_TABLE_SIZE) return -1;
+            decoder->max_size = index;
+            table_evict(decoder, index);
+            continue;
+        }
+        if (count >= max_headers) return -1;
+        HpackHeader *h = &headers[count];
+
+        if (first & 0x80) {
+            const char *name, *value;
+            if (decode_int(&p, end, 7, &index) < 0 ||
+                table_get(decoder, index, &name, &h->name_len, &value, &h->value_len) < 0) return -1;
+            h->name = copy_string(name, h->name_len, &scratch, &scratch_size);
+            h->value = copy_string(value, h->value_len, &scratch, &scratch_size);
+            if (!h->name || !h->value) return -1;
+            count++;
+            continue;
+        }
+
+        int incremental = (first & 0xc0) == 0x40;
+        if (decode_int(&p, end, incremental ? 6 : 4, &index) < 0) return -1;
+        if (index) {
+            const char *name, *value;
+            size_t value_len;
+            if (table_get(decoder, index, &name, &h->name_len, &value, &value_len) < 0) return -1;
+            h->name = copy_string(name, h->name_len, &scratch, &scratch_size);
+        } else {
+            h->name = decode_string(&p, end, &scratch, &scratch_size, &h->name_len);
+        }
+        if (!h->name) return -1;
+        h->value = decode_string(&p, end, &scratch, &scratch_size, &h->value_len);
+        if (!h->value) return -1;
+        if (incremental) table_insert(decoder, h);
+        count++;
+    }
+    return count;
+}
+
+static size_t encode_int(uint8_t *out, size_t size, uint8_t flags, int prefix, uint32_t value) {
+    uint32_t mask = (1u << prefix) - 1;
+    size_t n = 0;
+    if (size == 0) return 0;
+    if (value < mask) {
+        out[n++] = flags | value;
+        return n;
+    }
+    out[n++] = flags | mask;
+    value -= mask;
+    while (value >= 0x80) {
+        if (n >= size) return 0;
+        out[n++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    if (n >= size) return 0;
+    out[n++] = value;
+    return n;
+}
+
+static size_t encode_string(uint8_t *out, size_t size, const char *s) {
+    size_t len = strlen(s);
+    size_t n = encode_int(out, size, 0x00, 7, len);
+    if (n == 0 || n + len > size) return 0;
+    memcpy(out + n, s, len);
+    return n + len;
+}
+
+/* Literal without indexing, so the peer's table never has to hold our headers.
+   Names must be lowercase. Returns bytes written, 0 when out is too small. */
+size_t hpack_encode(uint8_t *out, size_t size, const char *name, const char *value) {
+    int name_index = 0;
+    for (int i = 0; i < 61; i++) {
+        if (strcmp(STATIC_TABLE[i].name, name) != 0) continue;
+        if (strcmp(STATIC_TABLE[i].value, value) == 0) return encode_int(out, size, 0x80, 7, i + 1);
+        if (!name_index) name_index = i + 1;
+    }
+
+    size_t n = encode_int(out, size, 0x00, 4, name_index);
+    if (n == 0) return 0;
+    if (!name_index) {
+        size_t m = encode_string(out + n, size - n, name);
+        if (m == 0) return 0;
+        n += m;
+    }
+    size_t m = encode_string(out + n, size - n, value);
+    return m == 0 ? 0 : n + m;
+}
@@ -0,0 +1,39 @@
+#ifndef hpack_h
+#define hpack_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HPACK_TABLE_SIZE 4096
+#define HPACK_MAX_ENTRIES (HPACK_TABLE_SIZE / 32)
+
+/* Points into the scratch buffer passed to hpack_decode(); both strings are NUL-terminated. */
+typedef struct {
+    const char *name;
+    const char *value;
+    size_t name_len;
+    size_t value_len;
+} HpackHeader;
+
+typedef struct {
+    char *data;
+    size_t name_len;
+    size_t value_len;
+} HpackEntry;
+
+/* Decoder side of one connection: the dynamic table is a ring, newest entry at head. */
+typedef struct {
+    HpackEntry entries[HPACK_MAX_ENTRIES];
+    int head;
+    int count;
+    size_t size;
+    size_t max_size;
+} HpackDecoder;
+
+void hpack_decoder_init(HpackDecoder *decoder);
+void hpack_decoder_free(HpackDecoder *decoder);
+int hpack_decode(HpackDecoder *decoder, const uint8_t *in, size_t len,
+                 HpackHeader *headers, int max_headers, char *scratch, size_t scratch_size);
+size_t hpack_encode(uint8_t *out, size_t size, const char *name, const char *value);
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "server.h"
+#include "listener.h"
+
+static int listener_address(const char *spec, struct sockaddr_storage *addr, socklen_t *len) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        if (strlen(spec + 5) >= sizeof(un->sun_path)) return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, spec + 5);
+        *len = sizeof(*un);
+        return 0;
+    }
+
+    char host[64];
+    int port;
+    if (spec[0] == '[') {
+        struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)addr;
+        if (sscanf(spec, "[%63[^]]]:%d", host, &port) != 2) return -1;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        if (inet_pton(AF_INET6, host, &in6->sin6_addr) <= 0) return -1;
+        *len = sizeof(*in6);
+        return 0;
+    }
+
+    struct sockaddr_in *in = (struct sockaddr_in *)addr;
+    if (sscanf(spec, "%63[^:]:%d", host, &port) != 2) return -1;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &in->sin_addr) <= 0) return -1;
+    *len = sizeof(*in);
+    return 0;
+}
+
+/* Removes a stale socket left by a previous run, but never a regular file or
+   anything else a mistyped "unix:" path may name. */
+static void unlink_socket(const char *path) {
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+}
+
+int listener_open(Listener *listener, const char *spec, int backlog, int defer_accept, int tcp_fastopen) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+
+    memset(listener, 0, sizeof(*listener));
+    listener->fd = -1;
+    snprintf(listener->spec, sizeof(listener->spec), "%s", spec);
+
+    if (listener_address(spec, &addr, &addr_len) < 0) {
+        LOG_ERROR("Invalid listen address: %s", spec);
+        return -1;
+    }
+    listener->family = addr.ss_family;
+
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int opt = 1;
+    if (addr.ss_family == AF_UNIX) {
+        unlink_socket(((struct sockaddr_un *)&addr)->sun_path);
+    } else {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (addr.ss_family == AF_INET6)
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt));
+        if (defer_accept > 0)
+            setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer_accept, sizeof(int));
+        if (tcp_fastopen > 0 && setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &tcp_fastopen, sizeof(int)) < 0)
+            LOG_WARN("TCP_FASTOPEN not available on %s", spec);
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    listener->fd = fd;
+    return 0;
+}
+
+void listener_close(Listener *listener) {
+    if (listener->fd < 0) return;
+    close(listener->fd);
+    listener->fd = -1;
+    if (listener->family == AF_UNIX) unlink_socket(listener->spec + 5);
+}
@@ -0,0 +1,16 @@
+#ifndef listener_h
+#define listener_h
+
+#define MAX_LISTENERS 8
+
+/* One "listen=" line: "HOST:PORT", "[IPV6]:PORT" or "unix:/path/to.sock". */
+typedef struct {
+    int fd;
+    int family;
+    char spec[128];
+} Listener;
+
+int listener_open(Listener *listener, const char *spec, int backlog, int defer_accept, int tcp_fastopen);
+void listener_close(Listener *listener);
+
+#endif
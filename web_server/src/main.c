@@ -1,9 +1,44 @@
 #include "server.h"
 #include <sys/stat.h>
 #include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void stop_handler(int sig) {
+    (void)sig;
+    server_stopping = 1;
+}
+
+static void child_handler(int sig) {
+    (void)sig;
+    workers_exited = 1;
+}
+
+static void trace_dump_handler(int sig) {
+    (void)sig;
+    trace_dump_requested = 1;
+}
+
 int main() {
 
-    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    /* Workers are reaped by the accept loop, which also returns their admission slot. */
+    sa.sa_handler = child_handler;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+
+    /* Forwarded to the workers by the accept loop; each one dumps its own ring. */
+    sa.sa_handler = trace_dump_handler;
+    sigaction(SIGUSR1, &sa, NULL);
 
     ServerConfig config = load_config("server.conf");
 
@@ -11,11 +46,26 @@ int main() {
 
     mkdir(config.storage_dir, 0777); 
 
+    preload_assets(&config);
+
     struct Server server = server_Constructor(config, launch);
 
+    /* Only after binding: an instance that cannot get its port must not touch the
+       segment of the server that has it. The default name is per port. */
+    if (config.stats_shm[0] == '\0') snprintf(config.stats_shm, sizeof(config.stats_shm), "/webserver.%d", config.port);
+    int stats = strcmp(config.stats_shm, "off") != 0 ? stats_create(config.stats_shm) : 0;
+    if (stats == -2) {
+        LOG_FATAL("Shared statistics %s belong to a running server", config.stats_shm);
+        return EXIT_FAILURE;
+    }
+    if (stats < 0) {
+        LOG_WARN("Shared statistics disabled: cannot create %s", config.stats_shm);
+    }
+
     LOG_DEBUG("Configuration loaded. Root: %s", config.root_dir);
     
     server.launch(&server);
-    
+
+    stats_destroy(config.stats_shm);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <string.h>
+#include "mime.h"
+
+#define MIME_TABLE_SIZE 64
+#define MIME_MAX_EXT 8
+
+/* Perfect hash over the extensions below: every extension lands in its own slot,
+   so a lookup is one hash and at most one string compare. The slot numbers were
+   found offline for these multipliers; re-run the search when adding a type. */
+#define MIME_HASH(ext, len) \
+    (((unsigned)(ext)[0] * 13 + (unsigned)(ext)[(len) - 1] * 31 + (unsigned)(len) * 45 + (unsigned)(ext)[1]) % MIME_TABLE_SIZE)
+
+static const MimeType MIME_TABLE[MIME_TABLE_SIZE] = {
+    [1]  = { "map",   "application/json",                 1 },
+    [4]  = { "html",  "text/html; charset=utf-8",         1 },
+    [5]  = { "gif",   "image/gif",                        0 },
+    [8]  = { "woff",  "font/woff",                        0 },
+    [10] = { "ogg",   "audio/ogg",                        0 },
+    [11] = { "csv",   "text/csv; charset=utf-8",          1 },
+    [12] = { "mp4",   "video/mp4",                        0 },
+    [13] = { "svg",   "image/svg+xml",                    1 },
+    [18] = { "jpg",   "image/jpeg",                       0 },
+    [19] = { "wasm",  "application/wasm",                 1 },
+    [21] = { "gz",    "application/gzip",                 0 },
+    [23] = { "webm",  "video/webm",                       0 },
+    [26] = { "tar",   "application/x-tar",                0 },
+    [27] = { "json",  "application/json",                 1 },
+    [28] = { "js",    "text/javascript; charset=utf-8",   1 },
+    [30] = { "png",   "image/png",                        0 },
+    [32] = { "xml",   "application/xml",                  1 },
+    [35] = { "md",    "text/markdown; charset=utf-8",     1 },
+    [39] = { "mjs",   "text/javascript; charset=utf-8",   1 },
+    [41] = { "woff2", "font/woff2",                       0 },
+    [45] = { "mp3",   "audio/mpeg",                       0 },
+    [46] = { "css",   "text/css; charset=utf-8",          1 },
+    [47] = { "txt",   "text/plain; charset=utf-8",        1 },
+    [48] = { "ico",   "image/x-icon",                     1 },
+    [49] = { "avif",  "image/avif",                       0 },
+    [50] = { "zip",   "application/zip",                  0 },
+    [52] = { "webp",  "image/webp",                       0 },
+    [53] = { "pdf",   "application/pdf",                  0 },
+    [54] = { "htm",   "text/html; charset=utf-8",         1 },
+    [56] = { "otf",   "font/otf",                         1 },
+    [57] = { "ttf",   "font/ttf",                         1 },
+    [60] = { "bin",   "application/octet-stream",         0 },
+    [61] = { "wav",   "audio/wav",                        0 },
+    [63] = { "jpeg",  "image/jpeg",                       0 },
+};
+
+static const MimeType MIME_DEFAULT = { "", "application/octet-stream", 0 };
+
+const MimeType *mime_lookup(const char *path) {
+    const char *dot = strrchr(path, '.');
+    const char *slash = strrchr(path, '/');
+    if (!dot || (slash && dot < slash)) return &MIME_DEFAULT;
+
+    char ext[MIME_MAX_EXT + 1] = {0};
+    size_t len = 0;
+    for (const char *p = dot + 1; *p && *p != '?'; p++) {
+        if (len == MIME_MAX_EXT) return &MIME_DEFAULT;
+        ext[len++] = (*p >= 'A' && *p <= 'Z') ? *p + ('a' - 'A') : *p;
+    }
+    if (len == 0) return &MIME_DEFAULT;
+
+    const MimeType *mime = &MIME_TABLE[MIME_HASH(ext, len)];
+    if (mime->ext && strcmp(mime->ext, ext) == 0) return mime;
+    return &MIME_DEFAULT;
+}
+
+const char *mime_type_for(const char *path) {
+    return mime_lookup(path)->type;
+}
@@ -0,0 +1,13 @@
+#ifndef mime_h
+#define mime_h
+
+typedef struct {
+    const char *ext;
+    const char *type;
+    int compressible;
+} MimeType;
+
+const MimeType *mime_lookup(const char *path);
+const char *mime_type_for(const char *path);
+
+#endif
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+#include "server.h"
+#include "path.h"
+
+PathCache path_cache = { .root_fd = -1 };
+
+static int openat2_missing = 0;
+
+int path_init(const char *root_dir, int ttl_ms) {
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) path_cache.entries[i].fd = -1;
+    path_cache.ttl_us = (long long)ttl_ms * 1000;
+    path_cache.root_fd = open(root_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    return path_cache.root_fd < 0 ? -1 : 0;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Percent-decodes the request target, drops the query, empty and "." segments and
+   rejects ".." anywhere, so encoded forms like %2e%2e/ cannot climb out of root.
+   out is relative to root_dir without a leading slash; "" means the root itself. */
+PathStatus path_canonicalize(const char *raw, char *out, size_t size) {
+    char decoded[PATH_MAX_LEN];
+    size_t len = 0;
+
+    if (raw[0] != '/') return PATH_BAD_REQUEST;
+    for (const char *p = raw; *p && *p != '?' && *p != '#'; p++) {
+        char c = *p;
+        if (c == '%') {
+            int hi = hex_value(p[1]), lo = hi < 0 ? -1 : hex_value(p[2]);
+            if (lo < 0) return PATH_BAD_REQUEST;
+            c = (char)(hi * 16 + lo);
+            if (c == '\0') return PATH_BAD_REQUEST;
+            p += 2;
+        }
+        if (len + 1 >= sizeof(decoded)) return PATH_BAD_REQUEST;
+        decoded[len++] = c;
+    }
+    decoded[len] = '\0';
+
+    size_t out_len = 0;
+    char *save, *segment = strtok_r(decoded, "/", &save);
+    for (; segment; segment = strtok_r(NULL, "/", &save)) {
+        if (strcmp(segment, ".") == 0) continue;
+        if (strcmp(segment, "..") == 0) return PATH_FORBIDDEN;
+        size_t seg_len = strlen(segment);
+        if (out_len + seg_len + 2 > size) return PATH_BAD_REQUEST;
+        if (out_len) out[out_len++] = '/';
+        memcpy(out + out_len, segment, seg_len);
+        out_len += seg_len;
+    }
+    out[out_len] = '\0';
+    return PATH_OK;
+}
+
+/* Opens rel under dir_fd without ever leaving it: symlinks and ".." that point
+   outside fail with EXDEV. Kernels without openat2() fall back to plain openat(). */
+int path_openat(int dir_fd, const char *rel, int flags) {
+    if (!openat2_missing) {
+        struct open_how how = {
+            .flags = flags | O_CLOEXEC,
+            .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+        };
+        int fd = syscall(SYS_openat2, dir_fd, rel[0] ? rel : ".", &how, sizeof(how));
+        if (fd >= 0 || errno != ENOSYS) return fd;
+        openat2_missing = 1;
+        LOG_WARN("openat2() not available, symlinks are not confined to root_dir");
+    }
+    return openat(dir_fd, rel[0] ? rel : ".", flags | O_CLOEXEC);
+}
+
+static unsigned int path_hash(const char *rel) {
+    unsigned int h = 2166136261u;
+    for (; *rel; rel++) {
+        h ^= (unsigned char)*rel;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void entry_release(PathEntry *entry) {
+    if (entry->fd >= 0) close(entry->fd);
+    entry->fd = -1;
+    entry->path[0] = '\0';
+}
+
+static PathEntry *entry_lookup(const char *rel, int need_readable, int flags) {
+    if (strlen(rel) >= PATH_MAX_LEN) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    PathEntry *entry = &path_cache.entries[path_hash(rel) & (PATH_CACHE_SIZE - 1)];
+    long long now = monotonic_us();
+    if (entry->path[0] && strcmp(entry->path, rel) == 0 && now - entry->resolved_us < path_cache.ttl_us) {
+        if (entry->fd < 0) {
+            errno = entry->err;
+            return NULL;
+        }
+        if ((entry->readable || !need_readable) && fstat(entry->fd, &entry->st) == 0) return entry;
+    }
+
+    entry_release(entry);
+    strcpy(entry->path, rel);
+    entry->resolved_us = now;
+    entry->readable = !(flags & O_PATH);
+    entry->fd = path_openat(path_cache.root_fd, rel, flags);
+    if (entry->fd < 0 || fstat(entry->fd, &entry->st) < 0) {
+        entry->err = errno;
+        if (entry->fd >= 0) close(entry->fd);
+        entry->fd = -1;
+        errno = entry->err;
+        return NULL;
+    }
+    return entry;
+}
+
+/* A hit costs one fstat() on the cached descriptor instead of a full path walk;
+   that still sees in-place edits. The walk is repeated after ttl to notice files
+   that were replaced or removed. */
+const PathEntry *path_resolve(const char *rel) {
+    return entry_lookup(rel, 1, O_RDONLY | O_NONBLOCK);
+}
+
+/* Metadata only: a miss walks with O_PATH, so the file itself is never opened.
+   Any cached entry will do, including one a GET left behind. */
+const PathEntry *path_stat(const char *rel) {
+    return entry_lookup(rel, 0, O_PATH);
+}
+
+void path_invalidate(const char *rel) {
+    PathEntry *entry = &path_cache.entries[path_hash(rel) & (PATH_CACHE_SIZE - 1)];
+    if (strcmp(entry->path, rel) == 0) entry_release(entry);
+}
+
+/* Removes a file (or empty directory) under root. The parent is opened with the
+   same confinement as path_openat(), so a symlinked directory cannot redirect it. */
+int path_unlink(const char *rel) {
+    char parent[PATH_MAX_LEN];
+    const char *name = strrchr(rel, '/');
+    if (name) {
+        snprintf(parent, sizeof(parent), "%.*s", (int)(name - rel), rel);
+        name++;
+    } else {
+        parent[0] = '\0';
+        name = rel;
+    }
+
+    int dir_fd = path_openat(path_cache.root_fd, parent, O_PATH | O_DIRECTORY);
+    if (dir_fd < 0) return -1;
+    int rc = unlinkat(dir_fd, name, 0);
+    if (rc < 0 && errno == EISDIR) rc = unlinkat(dir_fd, name, AT_REMOVEDIR);
+    int saved = errno;
+    close(dir_fd);
+    errno = saved;
+
+    path_invalidate(rel);
+    return rc;
+}
@@ -0,0 +1,45 @@
+#ifndef path_h
+#define path_h
+
+#include <sys/stat.h>
+
+#define PATH_CACHE_SIZE 256
+#define PATH_MAX_LEN 256
+
+typedef enum {
+    PATH_OK = 0,
+    PATH_BAD_REQUEST = -1,
+    PATH_FORBIDDEN = -2
+} PathStatus;
+
+/* A resolved request path relative to root_dir. fd < 0 caches a failed lookup
+   (err holds its errno) so repeated misses such as .gz probes skip the walk too.
+   Entries filled by path_stat() hold an O_PATH descriptor and are not readable. */
+typedef struct {
+    char path[PATH_MAX_LEN];
+    int fd;
+    int readable;
+    int err;
+    struct stat st;
+    long long resolved_us;
+} PathEntry;
+
+/* root_fd is opened by the master and inherited; the entries are private to
+   each worker and live as long as its keep-alive connection. */
+typedef struct {
+    int root_fd;
+    long long ttl_us;
+    PathEntry entries[PATH_CACHE_SIZE];
+} PathCache;
+
+extern PathCache path_cache;
+
+int path_init(const char *root_dir, int ttl_ms);
+PathStatus path_canonicalize(const char *raw, char *out, size_t size);
+int path_openat(int dir_fd, const char *rel, int flags);
+const PathEntry *path_resolve(const char *rel);
+const PathEntry *path_stat(const char *rel);
+void path_invalidate(const char *rel);
+int path_unlink(const char *rel);
+
+#endif
@@ -0,0 +1,668 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "server.h"
+#include "proxy.h"
+
+#define PROXY_SPLICE_CHUNK 65536
+
+/* Workers borrow idle upstream connections from the pool keeper and hand them back
+   over an AF_UNIX socket: one message each way, the fd riding along as SCM_RIGHTS. */
+enum { POOL_TAKE = 1, POOL_PUT };
+
+typedef struct {
+    int op;
+    int upstream;
+    int backend;
+} PoolMessage;
+
+static ProxyPool pool;
+static struct sockaddr_un keeper_address;
+static socklen_t keeper_address_len = 0;
+static int keeper_fd = -1;
+static pid_t keeper_owner = 0;
+
+/* Per-worker splice pipe for relaying bodies. */
+static int relay_pipe[2];
+static int relay_pipe_ready = 0;
+
+int proxy_parse_upstream(const char *value, Upstream *upstream) {
+    char list[512], balance[8] = "rr";
+    memset(upstream, 0, sizeof(*upstream));
+    if (sscanf(value, "%31s %511s %7s", upstream->name, list, balance) < 2) return -1;
+
+    upstream->balance = strcmp(balance, "lc") == 0 ? PROXY_BALANCE_LEAST_CONN : PROXY_BALANCE_ROUND_ROBIN;
+
+    char *save = NULL;
+    for (char *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (upstream->backend_count >= MAX_BACKENDS) break;
+        Backend *b = &upstream->backends[upstream->backend_count];
+        if (sscanf(tok, "%63[^:]:%d", b->host, &b->port) != 2) return -1;
+
+        b->address.sin_family = AF_INET;
+        b->address.sin_port = htons(b->port);
+        if (inet_pton(AF_INET, b->host, &b->address.sin_addr) <= 0) return -1;
+        upstream->backend_count++;
+    }
+    return upstream->backend_count > 0 ? 0 : -1;
+}
+
+int proxy_parse_rule(const char *value, ProxyRule *rule) {
+    memset(rule, 0, sizeof(*rule));
+    return sscanf(value, "%127s %31s", rule->prefix, rule->upstream) == 2 ? 0 : -1;
+}
+
+int proxy_find_upstream(const Upstream *upstreams, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(upstreams[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int proxy_init(ProxyShared **shared) {
+    *shared = mmap(NULL, sizeof(ProxyShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (*shared == MAP_FAILED) {
+        *shared = NULL;
+        return -1;
+    }
+    memset(*shared, 0, sizeof(ProxyShared));
+    return 0;
+}
+
+static int pool_prepare(void) {
+    if (relay_pipe_ready) return 0;
+    if (pipe2(relay_pipe, O_CLOEXEC) < 0) return -1;
+    fcntl(relay_pipe[1], F_SETPIPE_SZ, PROXY_SPLICE_CHUNK);
+    relay_pipe_ready = 1;
+    return 0;
+}
+
+/* Data stuck in the pipe after a failed splice would leak into the next relay. */
+static void pool_reset_pipe(void) {
+    close(relay_pipe[0]);
+    close(relay_pipe[1]);
+    relay_pipe_ready = 0;
+}
+
+static ssize_t send_with_fd(int sock, const void *data, size_t len, int fd) {
+    union {
+        struct cmsghdr header;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = { (void *)data, len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    if (fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &msg, MSG_NOSIGNAL);
+}
+
+static ssize_t recv_with_fd(int sock, void *data, size_t len, int *fd) {
+    union {
+        struct cmsghdr header;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = { data, len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+    *fd = -1;
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return n;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return n;
+}
+
+/* Keeper side: the newest idle connection the backend has not closed meanwhile. */
+static int keeper_take(int u, int b) {
+    while (pool.count[u][b] > 0) {
+        int fd = pool.fds[u][b][--pool.count[u][b]];
+        char c;
+        ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return fd;
+        close(fd);
+    }
+    return -1;
+}
+
+static void keeper_put(int u, int b, int fd) {
+    if (pool.count[u][b] < PROXY_POOL_SIZE) pool.fds[u][b][pool.count[u][b]++] = fd;
+    else close(fd);
+}
+
+/* Returns -1 once the worker has gone away. */
+static int keeper_serve(int client) {
+    PoolMessage msg;
+    int fd;
+    ssize_t n = recv_with_fd(client, &msg, sizeof(msg), &fd);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if (n <= 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (n != sizeof(msg) || msg.upstream < 0 || msg.upstream >= MAX_UPSTREAMS ||
+        msg.backend < 0 || msg.backend >= MAX_BACKENDS) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    if (msg.op == POOL_PUT) {
+        if (fd >= 0) keeper_put(msg.upstream, msg.backend, fd);
+        return 0;
+    }
+    if (fd >= 0) close(fd);
+    if (msg.op != POOL_TAKE) return -1;
+
+    int idle = keeper_take(msg.upstream, msg.backend);
+    int found = idle >= 0;
+    n = send_with_fd(client, &found, sizeof(found), idle);
+    if (idle >= 0) close(idle);
+    return n == sizeof(found) ? 0 : -1;
+}
+
+static void keeper_run(int listen_fd) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) return;
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = listen_fd };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0) return;
+
+    struct epoll_event events[64];
+    while (1) {
+        int ready = epoll_wait(epoll_fd, events, 64, -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return;
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd != listen_fd) {
+                if (keeper_serve(fd) < 0) close(fd);
+                continue;
+            }
+
+            int client = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0) continue;
+            /* The address is abstract, so any local process can reach it: only serve our own user. */
+            struct ucred cred;
+            socklen_t len = sizeof(cred);
+            if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || cred.uid != getuid()) {
+                close(client);
+                continue;
+            }
+            event.data.fd = client;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &event) < 0) close(client);
+        }
+    }
+}
+
+/* Forked by the master before the listeners open; it dies with the master. */
+pid_t proxy_start_keeper(void) {
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    /* Binding just the family autobinds a unique abstract address. */
+    memset(&keeper_address, 0, sizeof(keeper_address));
+    keeper_address.sun_family = AF_UNIX;
+    socklen_t len = sizeof(keeper_address);
+    if (bind(fd, (struct sockaddr *)&keeper_address, sizeof(sa_family_t)) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        getsockname(fd, (struct sockaddr *)&keeper_address, &len) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    pid_t master = getpid();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd);
+        return -1;
+    }
+    if (pid == 0) {
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGUSR1, SIG_IGN);
+        prctl(PR_SET_NAME, "proxy-pool");
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != master) _exit(0);
+        keeper_run(fd);
+        _exit(EXIT_FAILURE);
+    }
+    close(fd);
+    keeper_address_len = len;
+    return pid;
+}
+
+static void keeper_disconnect(void) {
+    close(keeper_fd);
+    keeper_fd = -1;
+}
+
+/* One keeper connection per process: an HTTP/2 stream worker must not share the one
+   its connection worker opened, or their replies would interleave. */
+static int keeper_connect(void) {
+    if (keeper_fd >= 0 && keeper_owner == getpid()) return keeper_fd;
+    if (keeper_fd >= 0) keeper_disconnect();
+    if (keeper_address_len == 0) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd, (struct sockaddr *)&keeper_address, keeper_address_len) < 0) {
+        close(fd);
+        return -1;
+    }
+    keeper_fd = fd;
+    keeper_owner = getpid();
+    return fd;
+}
+
+static int pool_take(int u, int b) {
+    int sock = keeper_connect();
+    if (sock < 0) return -1;
+
+    PoolMessage msg = { POOL_TAKE, u, b };
+    int found = 0;
+    int fd = -1;
+    if (send_with_fd(sock, &msg, sizeof(msg), -1) != sizeof(msg) ||
+        recv_with_fd(sock, &found, sizeof(found), &fd) != sizeof(found)) {
+        /* A late reply would be taken for the answer to the next request. */
+        keeper_disconnect();
+        found = 0;
+    }
+    if (!found && fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static void pool_put(int u, int b, int fd) {
+    int sock = keeper_connect();
+    PoolMessage msg = { POOL_PUT, u, b };
+    if (sock >= 0 && send_with_fd(sock, &msg, sizeof(msg), fd) != sizeof(msg)) keeper_disconnect();
+    close(fd);
+}
+
+static int backend_connect(const Backend *backend, int timeout) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    struct timeval tv = { .tv_sec = timeout, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, (const struct sockaddr *)&backend->address, sizeof(backend->address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return fd;
+}
+
+static int pick_backend(ProxyShared *shared, const Upstream *upstream, int u) {
+    if (!shared) return 0;
+    if (upstream->balance == PROXY_BALANCE_LEAST_CONN) {
+        int best = 0;
+        int best_active = __atomic_load_n(&shared->active[u][0], __ATOMIC_RELAXED);
+        for (int i = 1; i < upstream->backend_count; i++) {
+            int active = __atomic_load_n(&shared->active[u][i], __ATOMIC_RELAXED);
+            if (active < best_active) {
+                best = i;
+                best_active = active;
+            }
+        }
+        return best;
+    }
+    return __atomic_fetch_add(&shared->rr_next[u], 1, __ATOMIC_RELAXED) % upstream->backend_count;
+}
+
+/* Zero-copy socket to socket copy through the worker's pipe. len < 0 means until EOF. */
+static int splice_bytes(int from, int to, long long len) {
+    while (len != 0) {
+        size_t chunk = (len < 0 || len > PROXY_SPLICE_CHUNK) ? PROXY_SPLICE_CHUNK : (size_t)len;
+        ssize_t n = splice(from, NULL, relay_pipe[1], NULL, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && len < 0) return 0;
+        if (n <= 0) return -1;
+        trace_received(from, n);
+        if (len > 0) len -= n;
+
+        while (n > 0) {
+            ssize_t m = splice(relay_pipe[0], NULL, to, NULL, n, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (m < 0 && errno == EINTR) continue;
+            if (m <= 0) {
+                pool_reset_pipe();
+                return -1;
+            }
+            trace_sent(to, m);
+            n -= m;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    char data[BUFFER_SIZE];
+    size_t have;
+} RelayBuffer;
+
+static void relay_consume(RelayBuffer *rb, size_t n) {
+    memmove(rb->data, rb->data + n, rb->have - n);
+    rb->have -= n;
+}
+
+/* Sends len bytes: whatever is already buffered first, the rest via splice. */
+static int relay_body(RelayBuffer *rb, int to, long long len) {
+    size_t buffered = rb->have < (unsigned long long)len ? rb->have : (size_t)len;
+    if (buffered > 0) {
+        if (write_all(to, rb->data, buffered) < 0) return -1;
+        relay_consume(rb, buffered);
+        len -= buffered;
+    }
+    return len > 0 ? splice_bytes(rb->fd, to, len) : 0;
+}
+
+static int relay_line(RelayBuffer *rb, int to, char *line, size_t size) {
+    char *eol;
+    while (!(eol = memmem(rb->data, rb->have, "\r\n", 2))) {
+        if (rb->have >= sizeof(rb->data)) return -1;
+        ssize_t n = recv(rb->fd, rb->data + rb->have, sizeof(rb->data) - rb->have, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        trace_received(rb->fd, n);
+        rb->have += n;
+    }
+    size_t len = eol - rb->data + 2;
+    size_t copy = len < size ? len : size - 1;
+    memcpy(line, rb->data, copy);
+    line[copy] = '\0';
+    if (write_all(to, rb->data, len) < 0) return -1;
+    relay_consume(rb, len);
+    return 0;
+}
+
+/* Strict chunk-size: hex digits only, then an extension or the end of the line.
+   strtoll would also take a sign, "0x" and leading blanks, which the other side
+   of the relay may read differently. Returns -1 when malformed or too large. */
+static long long chunk_size(const char *line) {
+    long long size = 0;
+    const char *p = line;
+    for (; isxdigit((unsigned char)*p); p++) {
+        if (size > LLONG_MAX / 16 - 1) return -1;
+        size = size * 16 + (isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10));
+    }
+    if (p == line) return -1;
+    if (strcmp(p, "\r\n") == 0) return size;
+    while (*p == ' ' || *p == '\t') p++;
+    return *p == ';' ? size : -1;
+}
+
+/* Forwards a chunked body verbatim, parsing only the chunk sizes to find its end. */
+static int relay_chunked(RelayBuffer *rb, int to) {
+    char line[128];
+    while (1) {
+        if (relay_line(rb, to, line, sizeof(line)) < 0) return -1;
+        long long size = chunk_size(line);
+        if (size < 0) return -1;
+        if (size == 0) break;
+        if (relay_body(rb, to, size + 2) < 0) return -1;
+    }
+    do {
+        if (relay_line(rb, to, line, sizeof(line)) < 0) return -1;
+    } while (strcmp(line, "\r\n") != 0);
+    return 0;
+}
+
+/* How the request body is delimited (RFC 9112 §6). Returns 0, or the status to answer
+   instead of forwarding: 501 for a transfer coding other than a single "chunked",
+   400 for a malformed or conflicting Content-Length. */
+static int request_framing(HttpRequest *request, size_t head_len, int *chunked, long long *content_length) {
+    const char *line = strstr(request->buffer, "\r\n") + 2;
+    const char *end = request->buffer + head_len - 2;
+    int te_count = 0, cl_count = 0;
+    *content_length = 0;
+
+    while (line < end) {
+        const char *eol = memmem(line, end - line, "\r\n", 2);
+        const char *v = memchr(line, ':', eol - line);
+        if (v) {
+            size_t name_len = v - line;
+            for (v++; *v == ' ' || *v == '\t'; v++);
+            size_t len = eol - v;
+            while (len > 0 && (v[len - 1] == ' ' || v[len - 1] == '\t')) len--;
+            if (name_len == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) {
+                if (te_count++ || len != 7 || strncasecmp(v, "chunked", 7) != 0) return HTTP_NOT_IMPLEMENTED;
+            } else if (name_len == 14 && strncasecmp(line, "Content-Length", 14) == 0) {
+                long long value = 0;
+                if (len == 0 || len > 18) return HTTP_BAD_REQUEST;
+                for (size_t i = 0; i < len; i++) {
+                    if (!isdigit((unsigned char)v[i])) return HTTP_BAD_REQUEST;
+                    value = value * 10 + (v[i] - '0');
+                }
+                if (cl_count++ && value != *content_length) return HTTP_BAD_REQUEST;
+                *content_length = value;
+            }
+        }
+        line = eol + 2;
+    }
+    *chunked = te_count > 0;
+    if (*chunked && cl_count) {
+        /* Both: chunked wins, Content-Length is not forwarded and the connection
+           is closed after the response, as RFC 9112 §6.3 asks. */
+        *content_length = 0;
+        request->close_connection = 1;
+    }
+    return 0;
+}
+
+static int build_upstream_head(HttpRequest *request, size_t head_len, int chunked, char *out, size_t size) {
+    size_t len = 0;
+    const char *line = request->buffer;
+    const char *end = request->buffer + head_len - 2;
+
+    while (line < end) {
+        const char *eol = memmem(line, end - line, "\r\n", 2);
+        size_t line_len = eol - line + 2;
+        if (strncasecmp(line, "Connection:", 11) != 0 && strncasecmp(line, "Keep-Alive:", 11) != 0 &&
+            !(chunked && strncasecmp(line, "Content-Length:", 15) == 0)) {
+            if (len + line_len >= size) return -1;
+            memcpy(out + len, line, line_len);
+            len += line_len;
+        }
+        line = eol + 2;
+    }
+
+    /* The peer comes from the request: h2 streams reach us over a socketpair. */
+    char client_ip[INET6_ADDRSTRLEN] = "unknown";
+    const struct sockaddr_storage *peer = request->peer;
+    if (peer && peer->ss_family == AF_INET)
+        inet_ntop(AF_INET, &((const struct sockaddr_in *)peer)->sin_addr, client_ip, sizeof(client_ip));
+    else if (peer && peer->ss_family == AF_INET6)
+        inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)peer)->sin6_addr, client_ip, sizeof(client_ip));
+
+    int n = snprintf(out + len, size - len, "Connection: keep-alive\r\nX-Forwarded-For: %s\r\n\r\n", client_ip);
+    if (n < 0 || (size_t)n >= size - len) return -1;
+    return len + n;
+}
+
+/* Reads the upstream status line and headers. Returns the header length, 0 on a clean
+   close before any byte (stale pooled connection) and -1 on error. */
+static int read_response_head(RelayBuffer *rb) {
+    rb->have = 0;
+    while (1) {
+        char *end = memmem(rb->data, rb->have, "\r\n\r\n", 4);
+        if (end) return end - rb->data + 4;
+        if (rb->have >= sizeof(rb->data) - 1) return -1;
+
+        ssize_t n = recv(rb->fd, rb->data + rb->have, sizeof(rb->data) - 1 - rb->have, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && rb->have == 0) return 0;
+        if (n <= 0) return -1;
+        trace_received(rb->fd, n);
+        rb->have += n;
+        rb->data[rb->have] = '\0';
+    }
+}
+
+static int forward_request(int client, HttpRequest *request, int u, int b, int fd, int pooled,
+                           int request_chunked, long long content_length) {
+    static RelayBuffer up;
+    char head[BUFFER_SIZE];
+    char value[64];
+
+    char *head_end = strstr(request->buffer, "\r\n\r\n");
+    if (!head_end) return -1;
+    size_t client_head_len = head_end - request->buffer + 4;
+
+    int head_len = build_upstream_head(request, client_head_len, request_chunked, head, sizeof(head));
+    if (head_len < 0) return -1;
+
+    RelayBuffer *in = &up;
+    in->fd = client;
+    in->have = request->length - client_head_len;
+    memcpy(in->data, request->buffer + client_head_len, in->have);
+    int body_buffered = !request_chunked && (long long)in->have >= content_length;
+
+    if (write_all(fd, head, head_len) < 0) return pooled && body_buffered ? 1 : -1;
+    if (request_chunked) {
+        if (relay_chunked(in, fd) < 0) return -1;
+    } else if (content_length > 0) {
+        if (relay_body(in, fd, content_length) < 0) return -1;
+    }
+
+    in->fd = fd;
+    int resp_head_len = read_response_head(in);
+    if (resp_head_len == 0) return pooled && body_buffered ? 1 : -1;
+    if (resp_head_len < 0) return -1;
+
+    int status = 0;
+    sscanf(in->data, "HTTP/%*d.%*d %d", &status);
+    trace_status(status);
+
+    int keep = 1;
+    int chunked = 0;
+    long long length = -1;
+    char saved = in->data[resp_head_len];
+    in->data[resp_head_len] = '\0';
+    if (http_header_value(in->data, "Connection", value, sizeof(value)) && strcasecmp(value, "close") == 0) keep = 0;
+    if (http_header_value(in->data, "Transfer-Encoding", value, sizeof(value)) && strcasecmp(value, "chunked") == 0) chunked = 1;
+    else if (http_header_value(in->data, "Content-Length", value, sizeof(value))) length = atoll(value);
+    in->data[resp_head_len] = saved;
+
+    if (write_all(client, in->data, resp_head_len) < 0) {
+        request->close_connection = 1;
+        return -2;
+    }
+    relay_consume(in, resp_head_len);
+
+    int rc = 0;
+    int no_body = request->method_id == HTTP_METHOD_HEAD || status / 100 == 1 || status == 204 || status == 304;
+    if (no_body) {
+        rc = 0;
+    } else if (chunked) {
+        rc = relay_chunked(in, client);
+    } else if (length >= 0) {
+        rc = relay_body(in, client, length);
+    } else {
+        keep = 0;
+        request->close_connection = 1;
+        rc = write_all(client, in->data, in->have);
+        if (rc == 0) rc = splice_bytes(fd, client, -1);
+    }
+
+    if (rc < 0) {
+        request->close_connection = 1;
+        return -2;
+    }
+    if (keep && in->have == 0) pool_put(u, b, fd);
+    else close(fd);
+    return 0;
+}
+
+void handle_proxy(struct Server *server, int socket, HttpRequest *request) {
+    int u = request->route_arg;
+    const Upstream *upstream = &server->config.upstreams[u];
+    ProxyShared *shared = server->proxy_shared;
+
+    if (pool_prepare() < 0) {
+        send_response(socket, HTTP_INTERNAL_SERVER_ERROR, "text/html", "<html><body><h1>500 Error</h1></body></html>");
+        return;
+    }
+
+    int chunked;
+    long long content_length;
+    char *head_end = strstr(request->buffer, "\r\n\r\n");
+    int status = head_end ? request_framing(request, head_end - request->buffer + 4, &chunked, &content_length) : HTTP_BAD_REQUEST;
+    if (status == HTTP_NOT_IMPLEMENTED) {
+        request->close_connection = 1;
+        send_response(socket, HTTP_NOT_IMPLEMENTED, "text/html", "<html><body><h1>501 Not Implemented</h1></body></html>");
+        return;
+    }
+    if (status != 0) {
+        request->close_connection = 1;
+        send_response(socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>400 Bad Request</h1></body></html>");
+        return;
+    }
+
+    int first = pick_backend(shared, upstream, u);
+    for (int attempt = 0; attempt < upstream->backend_count; attempt++) {
+        int b = (first + attempt) % upstream->backend_count;
+        const Backend *backend = &upstream->backends[b];
+
+        int pooled = 1;
+        int fd = pool_take(u, b);
+        if (fd < 0) {
+            pooled = 0;
+            fd = backend_connect(backend, server->config.proxy_timeout);
+        }
+        if (fd < 0) {
+            LOG_WARN("Upstream %s backend %s:%d unreachable", upstream->name, backend->host, backend->port);
+            continue;
+        }
+
+        if (shared) __atomic_add_fetch(&shared->active[u][b], 1, __ATOMIC_RELAXED);
+        int rc = forward_request(socket, request, u, b, fd, pooled, chunked, content_length);
+        if (rc == 1) {
+            /* Pooled connection was closed by the backend before it answered: retry fresh. */
+            close(fd);
+            fd = backend_connect(backend, server->config.proxy_timeout);
+            rc = fd < 0 ? -1 : forward_request(socket, request, u, b, fd, 0, chunked, content_length);
+        }
+        if (shared) __atomic_sub_fetch(&shared->active[u][b], 1, __ATOMIC_RELAXED);
+
+        if (rc == 0) return;
+        if (fd >= 0) close(fd);
+        if (rc == -2) return;
+
+        LOG_ERROR("Proxy to %s:%d failed for %s %s", backend->host, backend->port, request->method, request->path);
+        break;
+    }
+    send_response(socket, HTTP_BAD_GATEWAY, "text/html", "<html><body><h1>502 Bad Gateway</h1></body></html>");
+}
@@ -0,0 +1,56 @@
+#ifndef proxy_h
+#define proxy_h
+
+#include <sys/types.h>
+#include <netinet/in.h>
+
+#define MAX_UPSTREAMS 8
+#define MAX_BACKENDS 8
+#define MAX_PROXY_RULES 16
+#define PROXY_POOL_SIZE 8
+
+typedef enum {
+    PROXY_BALANCE_ROUND_ROBIN = 0,
+    PROXY_BALANCE_LEAST_CONN
+} ProxyBalance;
+
+typedef struct {
+    char host[64];
+    int port;
+    struct sockaddr_in address;
+} Backend;
+
+/* "upstream=NAME HOST:PORT[,HOST:PORT...] [rr|lc]" */
+typedef struct {
+    char name[32];
+    Backend backends[MAX_BACKENDS];
+    int backend_count;
+    ProxyBalance balance;
+} Upstream;
+
+/* "proxy=PREFIX NAME": every method under PREFIX goes to upstream NAME. */
+typedef struct {
+    char prefix[128];
+    char upstream[32];
+} ProxyRule;
+
+/* Shared between workers so balancing sees the whole server, not one process. */
+typedef struct {
+    unsigned int rr_next[MAX_UPSTREAMS];
+    int active[MAX_UPSTREAMS][MAX_BACKENDS];
+} ProxyShared;
+
+/* Idle keep-alive upstream connections, held by the pool keeper process so they outlive
+   the connection workers that borrow them. */
+typedef struct {
+    int fds[MAX_UPSTREAMS][MAX_BACKENDS][PROXY_POOL_SIZE];
+    int count[MAX_UPSTREAMS][MAX_BACKENDS];
+} ProxyPool;
+
+int proxy_parse_upstream(const char *value, Upstream *upstream);
+int proxy_parse_rule(const char *value, ProxyRule *rule);
+int proxy_find_upstream(const Upstream *upstreams, int count, const char *name);
+int proxy_init(ProxyShared **shared);
+pid_t proxy_start_keeper(void);
+
+#endif
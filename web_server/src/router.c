@@ -0,0 +1,176 @@
+#include <string.h>
+#include "server.h"
+#include "router.h"
+
+static const char *METHOD_NAMES[HTTP_METHOD_COUNT] = {
+    "GET", "POST", "DELETE", "HEAD", "OPTIONS", "PUT", "PATCH"
+};
+
+static const struct {
+    const char *name;
+    RouteHandler handler;
+} HANDLERS[] = {
+    { "static",  handle_static  },
+    { "head",    handle_head    },
+    { "options", handle_options },
+    { "upload",  handle_post    },
+    { "delete",  handle_delete  },
+    { "metrics", handle_metrics },
+    { "health",  handle_health  },
+    { "trace",   handle_trace   },
+};
+
+HttpMethod http_method_parse(const char *method) {
+    for (int i = 0; i < HTTP_METHOD_COUNT; i++) {
+        if (method[0] == METHOD_NAMES[i][0] && strcmp(method, METHOD_NAMES[i]) == 0)
+            return (HttpMethod)i;
+    }
+    return HTTP_METHOD_UNKNOWN;
+}
+
+const char *http_method_name(HttpMethod method) {
+    if (method < 0 || method >= HTTP_METHOD_COUNT) return "UNKNOWN";
+    return METHOD_NAMES[method];
+}
+
+RouteHandler router_handler_by_name(const char *name) {
+    for (size_t i = 0; i < sizeof(HANDLERS) / sizeof(HANDLERS[0]); i++) {
+        if (strcmp(HANDLERS[i].name, name) == 0) return HANDLERS[i].handler;
+    }
+    return NULL;
+}
+
+void router_init(Router *router) {
+    memset(router, 0, sizeof(*router));
+    for (int i = 0; i < HTTP_METHOD_COUNT; i++) router->roots[i] = -1;
+}
+
+static int router_new_node(Router *router, int label_off, int label_len) {
+    if (router->node_count >= MAX_ROUTE_NODES) return -1;
+    int idx = router->node_count++;
+    RouteNode *node = &router->nodes[idx];
+    node->label_off = label_off;
+    node->label_len = label_len;
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->exact = NULL;
+    node->prefix = NULL;
+    return idx;
+}
+
+static int router_find_child(const Router *router, int parent, char c) {
+    for (int i = router->nodes[parent].first_child; i >= 0; i = router->nodes[i].next_sibling) {
+        if (router->labels[router->nodes[i].label_off] == c) return i;
+    }
+    return -1;
+}
+
+int router_add(Router *router, HttpMethod method, const char *pattern, RouteHandler handler, int arg) {
+    if (method >= HTTP_METHOD_COUNT || !pattern || !handler) return -1;
+
+    size_t len = strlen(pattern);
+    int is_prefix = len > 0 && pattern[len - 1] == '*';
+    if (is_prefix) len--;
+
+    if (router->roots[method] < 0) {
+        router->roots[method] = router_new_node(router, 0, 0);
+        if (router->roots[method] < 0) return -1;
+    }
+
+    int cur = router->roots[method];
+    const char *rest = pattern;
+    size_t rest_len = len;
+
+    while (rest_len > 0) {
+        int child = router_find_child(router, cur, rest[0]);
+        if (child < 0) {
+            if (router->label_used + rest_len > ROUTE_LABEL_POOL) return -1;
+            memcpy(router->labels + router->label_used, rest, rest_len);
+            child = router_new_node(router, router->label_used, rest_len);
+            if (child < 0) return -1;
+            router->label_used += rest_len;
+            router->nodes[child].next_sibling = router->nodes[cur].first_child;
+            router->nodes[cur].first_child = child;
+            cur = child;
+            break;
+        }
+
+        RouteNode *node = &router->nodes[child];
+        const char *label = router->labels + node->label_off;
+        size_t common = 0;
+        while (common < node->label_len && common < rest_len && label[common] == rest[common]) common++;
+
+        if (common < node->label_len) {
+            /* Split the edge: the new middle node keeps the shared head of the label. */
+            int mid = router_new_node(router, node->label_off, common);
+            if (mid < 0) return -1;
+            node = &router->nodes[child];
+
+            short *link = &router->nodes[cur].first_child;
+            while (*link != child) link = &router->nodes[*link].next_sibling;
+            *link = mid;
+            router->nodes[mid].next_sibling = node->next_sibling;
+            router->nodes[mid].first_child = child;
+            node->next_sibling = -1;
+            node->label_off += common;
+            node->label_len -= common;
+            child = mid;
+        }
+
+        cur = child;
+        rest += common;
+        rest_len -= common;
+    }
+
+    if (is_prefix) {
+        router->nodes[cur].prefix = handler;
+        router->nodes[cur].prefix_arg = arg;
+    } else {
+        router->nodes[cur].exact = handler;
+        router->nodes[cur].exact_arg = arg;
+    }
+    return 0;
+}
+
+int router_add_spec(Router *router, const RouteSpec *spec) {
+    HttpMethod method = http_method_parse(spec->method);
+    RouteHandler handler = router_handler_by_name(spec->handler);
+    if (method == HTTP_METHOD_UNKNOWN || !handler) return -1;
+    return router_add(router, method, spec->pattern, handler, 0);
+}
+
+/* Longest-prefix match; an exact route on the final node wins over any prefix.
+   The handler's argument (e.g. an upstream index) is stored into *arg when given. */
+RouteHandler router_lookup(const Router *router, HttpMethod method, const char *path, int *arg) {
+    if (method >= HTTP_METHOD_COUNT || router->roots[method] < 0) return NULL;
+
+    const RouteNode *node = &router->nodes[router->roots[method]];
+    const RouteNode *best = NULL;
+
+    while (1) {
+        if (node->prefix) best = node;
+        if (*path == '\0' || *path == '?') {
+            if (node->exact) {
+                if (arg) *arg = node->exact_arg;
+                return node->exact;
+            }
+            break;
+        }
+
+        int child = router_find_child(router, node - router->nodes, *path);
+        if (child < 0) break;
+
+        const RouteNode *next = &router->nodes[child];
+        const char *label = router->labels + next->label_off;
+        int i = 0;
+        while (i < next->label_len && path[i] == label[i]) i++;
+        if (i < next->label_len) break;
+
+        path += next->label_len;
+        node = next;
+    }
+
+    if (!best) return NULL;
+    if (arg) *arg = best->prefix_arg;
+    return best->prefix;
+}
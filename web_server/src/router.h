@@ -0,0 +1,64 @@
+#ifndef router_h
+#define router_h
+
+#define MAX_ROUTES 32
+#define MAX_ROUTE_NODES 128
+#define ROUTE_LABEL_POOL 4096
+
+typedef enum {
+    HTTP_METHOD_GET = 0,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_OPTIONS,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_COUNT,
+    HTTP_METHOD_UNKNOWN = HTTP_METHOD_COUNT
+} HttpMethod;
+
+struct Server;
+struct HttpRequest;
+
+typedef void (*RouteHandler)(struct Server *server, int socket, struct HttpRequest *request);
+
+/* One "route=METHOD PATTERN HANDLER" line from the config.
+   A pattern ending in '*' matches by prefix, anything else must match exactly. */
+typedef struct {
+    char method[16];
+    char pattern[128];
+    char handler[32];
+} RouteSpec;
+
+/* Radix trie node. Edge labels live in the router's label pool, children are
+   a sibling list with distinct first bytes. Indices instead of pointers keep
+   the whole table relocatable, so struct Server can still be returned by value. */
+typedef struct {
+    unsigned short label_off;
+    unsigned short label_len;
+    short first_child;
+    short next_sibling;
+    RouteHandler exact;
+    RouteHandler prefix;
+    short exact_arg;
+    short prefix_arg;
+} RouteNode;
+
+typedef struct Router {
+    RouteNode nodes[MAX_ROUTE_NODES];
+    int node_count;
+    short roots[HTTP_METHOD_COUNT];
+    char labels[ROUTE_LABEL_POOL];
+    int label_used;
+} Router;
+
+HttpMethod http_method_parse(const char *method);
+const char *http_method_name(HttpMethod method);
+
+void router_init(Router *router);
+int router_add(Router *router, HttpMethod method, const char *pattern, RouteHandler handler, int arg);
+int router_add_spec(Router *router, const RouteSpec *spec);
+RouteHandler router_lookup(const Router *router, HttpMethod method, const char *path, int *arg);
+RouteHandler router_handler_by_name(const char *name);
+
+#endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -5,17 +6,33 @@
 #include <string.h>
 #include "server.h"
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #include <stdarg.h>
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/wait.h>
+#include <strings.h>
 
 static char LOG_FILE_PATH[256] = "";
 
+volatile sig_atomic_t server_stopping = 0;
+volatile sig_atomic_t workers_exited = 0;
+volatile sig_atomic_t trace_dump_requested = 0;
+
+long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void logger_init(const char *filename) {
     if (filename && strlen(filename) > 0) {
-        strncpy(LOG_FILE_PATH, filename, sizeof(LOG_FILE_PATH) - 1);
+        snprintf(LOG_FILE_PATH, sizeof(LOG_FILE_PATH), "%s", filename);
     }
 }
 
@@ -56,72 +73,211 @@ void log_message(LogLevel level, const char *file, int line, const char *format,
     }
 }
 
-void send_response(int socket, HttpStatusCode status_code, char *content_type, char *body) {
-    char header[BUFFER_SIZE];
-    char *status_text;
-
+static const char *http_status_text(HttpStatusCode status_code) {
     switch (status_code) {
-        case HTTP_OK: status_text = "OK"; break;
-        case HTTP_CREATED: status_text = "Created"; break;
-        case HTTP_BAD_REQUEST: status_text = "Bad Request"; break;
-        case HTTP_FORBIDDEN: status_text = "Forbidden"; break;
-        case HTTP_NOT_FOUND: status_text = "Not Found"; break;
-        case HTTP_INTERNAL_SERVER_ERROR: status_text = "Internal Server Error"; break;
-        case HTTP_NOT_IMPLEMENTED: status_text = "Not Implemented"; break;
-        case HTTP_SERVICE_UNAVAILABLE: status_text = "Service Unavailable"; break;
-        default: status_text = "Unknown"; break;
-    }
-
-    int len = sprintf(header, 
+        case HTTP_OK: return "OK";
+        case HTTP_CREATED: return "Created";
+        case HTTP_NO_CONTENT: return "No Content";
+        case HTTP_BAD_REQUEST: return "Bad Request";
+        case HTTP_FORBIDDEN: return "Forbidden";
+        case HTTP_NOT_FOUND: return "Not Found";
+        case HTTP_INTERNAL_SERVER_ERROR: return "Internal Server Error";
+        case HTTP_NOT_IMPLEMENTED: return "Not Implemented";
+        case HTTP_BAD_GATEWAY: return "Bad Gateway";
+        case HTTP_SERVICE_UNAVAILABLE: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+static int build_response_header(char *out, size_t size, HttpStatusCode status_code,
+                                 const char *content_type, size_t length) {
+    return snprintf(out, size,
         "HTTP/1.1 %d %s\r\n"
         "Content-Type: %s\r\n"
-        "Content-Length: %lu\r\n"
+        "Content-Length: %zu\r\n"
         "\r\n",
-        status_code, status_text, content_type, body ? strlen(body) : 0);
+        status_code, http_status_text(status_code), content_type, length);
+}
 
+void send_response(int socket, HttpStatusCode status_code, char *content_type, char *body) {
+    char header[BUFFER_SIZE];
+    int len = build_response_header(header, sizeof(header), status_code, content_type, body ? strlen(body) : 0);
+
+    trace_status(status_code);
     if (write(socket, header, len) < 0) return;
+    trace_sent(socket, len);
 
-    if (body) {
-        write(socket, body, strlen(body));
+    if (body && write(socket, body, strlen(body)) > 0) {
+        trace_sent(socket, strlen(body));
     }
 }
 
-void send_file_stream(int socket, const char *filepath) {
-    int fd = open(filepath, O_RDONLY);
-    if (fd == -1) {
-        LOG_ERROR("Cannot open file: %s", filepath);
-        send_response(socket, HTTP_NOT_FOUND, "text/html", "<html><body><h1>404 Not Found</h1></body></html>");
-        return;
+/* The header send_response() would write for body, without the body (HEAD). */
+static void send_response_head(int socket, HttpStatusCode status_code, char *content_type, char *body) {
+    char header[512];
+    int len = build_response_header(header, sizeof(header), status_code, content_type, strlen(body));
+    trace_status(status_code);
+    write_all(socket, header, len);
+}
+
+int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        trace_sent(fd, n);
+        p += n;
+        len -= n;
     }
+    return 0;
+}
 
-    struct stat file_stat;
-    if (fstat(fd, &file_stat) < 0) {
-        close(fd);
-        return;
+/* Case-insensitive lookup of a header in a raw request or response head. */
+const char *http_header_value(const char *head, const char *name, char *out, size_t size) {
+    size_t name_len = strlen(name);
+    const char *line = strstr(head, "\r\n");
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *v = line + name_len + 1;
+            while (*v == ' ') v++;
+            size_t len = strcspn(v, "\r\n");
+            if (len >= size) len = size - 1;
+            memcpy(out, v, len);
+            out[len] = '\0';
+            return out;
+        }
+        line = strstr(line, "\r\n");
     }
+    return NULL;
+}
 
-    char header[1024];
-    int len = sprintf(header, 
+static int build_file_header(char *out, size_t size, const MimeType *mime, size_t length, int gzip) {
+    return snprintf(out, size,
         "HTTP/1.1 200 OK\r\n"
-        "Content-Type: text/html\r\n"
-        "Content-Length: %ld\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "%s%s"
         "\r\n",
-        file_stat.st_size);
-    
-    if (write(socket, header, len) < 0) {
+        mime->type, length,
+        gzip ? "Content-Encoding: gzip\r\n" : "",
+        mime->compressible ? "Vary: Accept-Encoding\r\n" : "");
+}
+
+static void send_buffer_body(int socket, const MimeType *mime, const void *data, size_t size, int gzip) {
+    char header[512];
+    int len = build_file_header(header, sizeof(header), mime, size, gzip);
+    trace_status(HTTP_OK);
+    if (write_all(socket, header, len) == 0) write_all(socket, data, size);
+}
+
+static void send_fd_body(int socket, const MimeType *mime, int fd, size_t size, int gzip) {
+    char header[512];
+    int len = build_file_header(header, sizeof(header), mime, size, gzip);
+    trace_status(HTTP_OK);
+    if (write_all(socket, header, len) < 0) return;
+
+    off_t offset = 0;
+    while ((size_t)offset < size) {
+        ssize_t n = sendfile(socket, fd, &offset, size - offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        trace_sent(socket, n);
+    }
+}
+
+/* Serves a precompressed sibling (file.gz) if one exists. */
+static int send_precompressed(int socket, const char *rel_path, const MimeType *mime) {
+    char gz_path[PATH_MAX_LEN];
+    if (snprintf(gz_path, sizeof(gz_path), "%s.gz", rel_path) >= (int)sizeof(gz_path)) return -1;
+    const PathEntry *gz = path_resolve(gz_path);
+    if (!gz || !S_ISREG(gz->st.st_mode)) return -1;
+
+    trace_stamp(TRACE_FILE_OPENED);
+    send_fd_body(socket, mime, gz->fd, gz->st.st_size, 1);
+    return 0;
+}
+
+/* Files outside the preloaded cache are compressed by the first worker that serves them
+   and kept in gzip_cache_dir for every later one; an empty copy marks a file gzip does
+   not shrink. Returns -1 when the body should go out uncompressed. */
+static int send_gzip_copy(struct Server *server, int socket, const char *rel_path, const MimeType *mime,
+                          const PathEntry *resolved) {
+    struct stat gz_st;
+    int fd = gzip_cache_open(rel_path, &resolved->st, &gz_st);
+    if (fd >= 0) {
+        if (gz_st.st_size > 0) {
+            trace_stamp(TRACE_FILE_OPENED);
+            send_fd_body(socket, mime, fd, gz_st.st_size, 1);
+        }
         close(fd);
+        return gz_st.st_size > 0 ? 0 : -1;
+    }
+
+    /* Same bound as the content cache, so one huge file cannot balloon a worker. */
+    size_t size = resolved->st.st_size;
+    if (size > content_cache.max_bytes) return -1;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, resolved->fd, 0);
+    if (data == MAP_FAILED) return -1;
+    void *gz_data = NULL;
+    size_t gz_size = 0;
+    int rc = gzip_compress(data, size, server->config.gzip_level, &gz_data, &gz_size);
+    munmap(data, size);
+
+    /* Not kept if the file changed while it was being read. */
+    struct stat now;
+    if (fstat(resolved->fd, &now) == 0 && now.st_size == resolved->st.st_size &&
+        now.st_mtim.tv_sec == resolved->st.st_mtim.tv_sec && now.st_mtim.tv_nsec == resolved->st.st_mtim.tv_nsec) {
+        gzip_cache_store(rel_path, &resolved->st, gz_data, rc == 0 ? gz_size : 0);
+    }
+    if (rc < 0) return -1;
+
+    trace_stamp(TRACE_FILE_OPENED);
+    send_buffer_body(socket, mime, gz_data, gz_size, 1);
+    free(gz_data);
+    return 0;
+}
+
+/* rel_path is a canonical path below root_dir (see path_canonicalize). */
+void send_file_stream(struct Server *server, int socket, const char *rel_path, int accept_gzip) {
+    const MimeType *mime = mime_lookup(rel_path);
+    int want_gzip = accept_gzip && server->config.gzip;
+
+    char filepath[PATH_MAX_LEN + 256];
+    snprintf(filepath, sizeof(filepath), "%s/%s", server->config.root_dir, rel_path);
+
+    if (want_gzip && send_precompressed(socket, rel_path, mime) == 0) {
+        cache_count_request(filepath);
         return;
     }
 
-    char file_buffer[4096];
-    ssize_t bytes_read;
-    while ((bytes_read = read(fd, file_buffer, sizeof(file_buffer))) > 0) {
-        if (write(socket, file_buffer, bytes_read) < 0) {
-            break;
-        }
+    const PathEntry *resolved = path_resolve(rel_path);
+    if (!resolved || !S_ISREG(resolved->st.st_mode)) {
+        LOG_ERROR("Cannot open file: %s", rel_path);
+        send_response(socket, HTTP_NOT_FOUND, "text/html", "<html><body><h1>404 Not Found</h1></body></html>");
+        return;
     }
+    cache_count_request(filepath);
+
+    CacheEntry *cached = cache_lookup(filepath);
+    if (cached && !cache_entry_fresh(cached, &resolved->st)) cached = NULL;
 
-    close(fd);
+    int compress = want_gzip && mime->compressible && resolved->st.st_size >= server->config.gzip_min_size;
+    if (!cached && compress && send_gzip_copy(server, socket, rel_path, mime, resolved) == 0) return;
+
+    if (cached) {
+        trace_stamp(TRACE_FILE_OPENED);
+        cache_hit(cached);
+        if (compress && cache_compress(cached, server->config.gzip_level) == 0)
+            send_buffer_body(socket, mime, cached->gz_data, cached->gz_size, 1);
+        else
+            send_buffer_body(socket, mime, cached->data, cached->size, 0);
+        return;
+    }
+
+    trace_stamp(TRACE_FILE_OPENED);
+    send_fd_body(socket, mime, resolved->fd, resolved->st.st_size, 0);
 }
 
 void handle_upload(int socket, long content_length, const char *filename, char *initial_data, int initial_len) {
@@ -143,7 +299,9 @@ void handle_upload(int socket, long content_length, const char *filename, char *
     ssize_t bytes_read;
 
     while (total_written < content_length) {
-        bytes_read = read(socket, buffer, sizeof(buffer));
+        /* Never past the body: a pipelined request may follow it. */
+        long want = content_length - total_written < (long)sizeof(buffer) ? content_length - total_written : (long)sizeof(buffer);
+        bytes_read = read(socket, buffer, want);
         
         if (bytes_read < 0) {
              LOG_ERROR("Error reading socket during upload");
@@ -154,164 +312,632 @@ void handle_upload(int socket, long content_length, const char *filename, char *
              break;
         }
 
+        trace_received(socket, bytes_read);
         fwrite(buffer, 1, bytes_read, f);
         total_written += bytes_read;
     }
 
     fclose(f);
+    trace_upload(total_written);
     LOG_INFO("File uploaded: %s (%ld bytes)", filename, total_written);
     send_response(socket, HTTP_CREATED, "text/plain", "File Uploaded Successfully");
 }
 
+static const RouteSpec DEFAULT_ROUTES[] = {
+    { "GET",    "/*",       "static"  },
+    { "POST",   "/*",       "upload"  },
+    { "DELETE", "/*",       "delete"  },
+    { "HEAD",   "/*",       "head"    },
+    { "OPTIONS", "/*",      "options" },
+    { "GET",    "/health",  "health"  },
+    { "GET",    "/metrics", "metrics" },
+};
+
 struct Server server_Constructor(ServerConfig config, void (*launch)(struct Server *server)) {
     struct Server server;
     server.config = config;
     server.launch = launch;
+    server.started_at = time(NULL);
+    server.epoll_fd = -1;
 
-    server.address.sin_family = AF_INET;
-    server.address.sin_port = htons(config.port);
-    
-    if (inet_pton(AF_INET, config.ip_address, &server.address.sin_addr) <= 0) {
-        LOG_ERROR("Invalid address: %s", config.ip_address);
-        server.address.sin_addr.s_addr = INADDR_ANY; 
+    trace_init((long long)config.trace_slow_ms * 1000, config.trace_dump);
+
+    if (admission_init(&server.admission, config.max_inflight, config.admission_target_ms, config.admission_interval_ms) < 0) {
+        LOG_WARN("Admission control disabled: cannot map shared state");
     }
 
-    server.socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server.socket < 0) {
-        LOG_FATAL("Failed to initialize socket");
-        exit(EXIT_FAILURE);
+    if (path_init(config.root_dir, config.path_cache_ttl_ms) < 0) {
+        LOG_ERROR("Cannot open root_dir %s: %s", config.root_dir, strerror(errno));
     }
 
-    int opt = 1;
-    setsockopt(server.socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (config.gzip && config.gzip_cache_dir[0] && gzip_cache_init(config.gzip_cache_dir) < 0) {
+        LOG_WARN("Compressed copies are not kept: cannot open gzip_cache_dir %s", config.gzip_cache_dir);
+    }
 
-    if (bind(server.socket, (struct sockaddr*)&server.address, sizeof(server.address)) < 0) {
-        LOG_FATAL("Bind failed on port %d", config.port);
-        exit(EXIT_FAILURE);
+    if (access_log_init(config.access_log, config.access_log_segment_mb) < 0) {
+        LOG_WARN("Access log disabled: cannot open segment for %s", config.access_log);
     }
 
-    if (listen(server.socket, config.backlog) < 0) {
-        LOG_FATAL("Listen failed");
-        exit(EXIT_FAILURE);
+    router_init(&server.router);
+    for (size_t i = 0; i < sizeof(DEFAULT_ROUTES) / sizeof(DEFAULT_ROUTES[0]); i++) {
+        router_add_spec(&server.router, &DEFAULT_ROUTES[i]);
+    }
+    for (int i = 0; i < config.route_count; i++) {
+        if (router_add_spec(&server.router, &config.routes[i]) < 0) {
+            LOG_ERROR("Invalid route: %s %s %s", config.routes[i].method, config.routes[i].pattern, config.routes[i].handler);
+        }
+    }
+
+    char allow[128] = "";
+    for (int i = 0; i < HTTP_METHOD_COUNT; i++) {
+        if (server.router.roots[i] < 0) continue;
+        if (allow[0]) strcat(allow, ", ");
+        strcat(allow, http_method_name(i));
+    }
+    server.options_length = snprintf(server.options_response, sizeof(server.options_response),
+        "HTTP/1.1 204 No Content\r\n"
+        "Allow: %s\r\n"
+        "\r\n", allow);
+
+    server.accepted_total = 0;
+    server.workers = NULL;
+    server.worker_count = 0;
+    server.worker_capacity = 0;
+    if (affinity_parse(config.worker_affinity, &server.affinity) < 0) {
+        LOG_ERROR("Invalid worker_affinity: %s", config.worker_affinity);
+        server.affinity.mode = AFFINITY_OFF;
+    }
+
+    server.proxy_shared = NULL;
+    if (config.proxy_rule_count > 0 && proxy_init(&server.proxy_shared) < 0) {
+        LOG_WARN("Proxy balancing state is per worker: cannot map shared state");
+    }
+    server.proxy_keeper = config.proxy_rule_count > 0 ? proxy_start_keeper() : 0;
+    if (server.proxy_keeper < 0) {
+        LOG_WARN("Upstream connections are not pooled: cannot start the pool keeper");
+    }
+    for (int i = 0; i < config.proxy_rule_count; i++) {
+        const ProxyRule *rule = &config.proxy_rules[i];
+        int upstream = proxy_find_upstream(config.upstreams, config.upstream_count, rule->upstream);
+        if (upstream < 0) {
+            LOG_ERROR("Proxy rule %s: unknown upstream %s", rule->prefix, rule->upstream);
+            continue;
+        }
+        char pattern[sizeof(rule->prefix) + 1];
+        snprintf(pattern, sizeof(pattern), "%s*", rule->prefix);
+        for (int m = 0; m < HTTP_METHOD_COUNT; m++) {
+            router_add(&server.router, (HttpMethod)m, pattern, handle_proxy, upstream);
+        }
+    }
+
+    if (config.listen_count == 0) {
+        snprintf(config.listen[0], sizeof(config.listen[0]), "%s:%d", config.ip_address, config.port);
+        config.listen_count = 1;
+        server.config = config;
+    }
+
+    server.listener_count = 0;
+    for (int i = 0; i < config.listen_count; i++) {
+        Listener *listener = &server.listeners[server.listener_count];
+        if (listener_open(listener, config.listen[i], config.backlog, config.defer_accept, config.tcp_fastopen) < 0) {
+            LOG_FATAL("Cannot listen on %s", config.listen[i]);
+            exit(EXIT_FAILURE);
+        }
+        server.listener_count++;
     }
 
     return server;
 }
 
-void launch(struct Server *server) {
+static unsigned long worker_requests = 0;
+static int worker_cpu = -1;
+
+/* Answers 400/403 for paths that fail canonicalization; returns 0 when rel is usable. */
+static int resolve_request_path(int socket, const HttpRequest *request, char *rel, size_t size) {
+    PathStatus status = path_canonicalize(request->path, rel, size);
+    if (status == PATH_FORBIDDEN) {
+        send_response(socket, HTTP_FORBIDDEN, "text/html", "<html><body><h1>403 Forbidden</h1></body></html>");
+        return -1;
+    }
+    if (status != PATH_OK) {
+        send_response(socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>400 Bad Request</h1></body></html>");
+        return -1;
+    }
+    return 0;
+}
+
+void handle_static(struct Server *server, int socket, HttpRequest *request) {
+    char rel[PATH_MAX_LEN];
+    if (resolve_request_path(socket, request, rel, sizeof(rel)) < 0) return;
+    if (rel[0] == '\0') strcpy(rel, "index.html");
+    send_file_stream(server, socket, rel, accepts_gzip(request->buffer));
+}
+
+/* Same headers as handle_static() from one cached stat: the file is never opened
+   or read. A gzip length is only known for a .gz sibling or an already compressed
+   cache entry; otherwise the identity length is reported. */
+void handle_head(struct Server *server, int socket, HttpRequest *request) {
+    char rel[PATH_MAX_LEN];
+    PathStatus status = path_canonicalize(request->path, rel, sizeof(rel));
+    if (status == PATH_FORBIDDEN) {
+        send_response_head(socket, HTTP_FORBIDDEN, "text/html", "<html><body><h1>403 Forbidden</h1></body></html>");
+        return;
+    }
+    if (status != PATH_OK) {
+        send_response_head(socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>400 Bad Request</h1></body></html>");
+        return;
+    }
+    if (rel[0] == '\0') strcpy(rel, "index.html");
+
+    const MimeType *mime = mime_lookup(rel);
+    int want_gzip = accepts_gzip(request->buffer) && server->config.gzip;
+    char header[512];
+
+    if (want_gzip) {
+        char gz_path[PATH_MAX_LEN];
+        const PathEntry *gz = NULL;
+        if (snprintf(gz_path, sizeof(gz_path), "%s.gz", rel) < (int)sizeof(gz_path)) gz = path_stat(gz_path);
+        if (gz && S_ISREG(gz->st.st_mode)) {
+            trace_status(HTTP_OK);
+            write_all(socket, header, build_file_header(header, sizeof(header), mime, gz->st.st_size, 1));
+            return;
+        }
+    }
+
+    const PathEntry *resolved = path_stat(rel);
+    if (!resolved || !S_ISREG(resolved->st.st_mode)) {
+        send_response_head(socket, HTTP_NOT_FOUND, "text/html", "<html><body><h1>404 Not Found</h1></body></html>");
+        return;
+    }
+
+    size_t length = resolved->st.st_size;
+    int gzip = 0;
+    if (want_gzip && mime->compressible) {
+        char filepath[PATH_MAX_LEN + 256];
+        snprintf(filepath, sizeof(filepath), "%s/%s", server->config.root_dir, rel);
+        const CacheEntry *cached = cache_lookup(filepath);
+        struct stat gz_st;
+        int fd = -1;
+        if (cached && cached->gz_state == 1 && cache_entry_fresh(cached, &resolved->st)) {
+            length = cached->gz_size;
+            gzip = 1;
+        } else if ((fd = gzip_cache_open(rel, &resolved->st, &gz_st)) >= 0) {
+            if (gz_st.st_size > 0) {
+                length = gz_st.st_size;
+                gzip = 1;
+            }
+            close(fd);
+        }
+    }
+    trace_status(HTTP_OK);
+    write_all(socket, header, build_file_header(header, sizeof(header), mime, length, gzip));
+}
+
+/* Built once by the constructor from the methods that have routes. */
+void handle_options(struct Server *server, int socket, HttpRequest *request) {
+    (void)request;
+    trace_status(HTTP_NO_CONTENT);
+    write_all(socket, server->options_response, server->options_length);
+}
+
+void handle_post(struct Server *server, int socket, HttpRequest *request) {
+    long content_len = 0;
+    char *len_str = strstr(request->buffer, "Content-Length: ");
+    if (len_str) sscanf(len_str, "Content-Length: %ld", &content_len);
+
+    char *body_start = strstr(request->buffer, "\r\n\r\n");
+    int initial_body_len = 0;
+    if (body_start) {
+        body_start += 4;
+        initial_body_len = request->length - (body_start - request->buffer);
+    } else {
+        body_start = NULL; 
+    }
+
+    if (content_len > 0) {
+        char save_path[512];
+        snprintf(save_path, sizeof(save_path), "%s/upload_%d_%ld.bin", 
+            server->config.storage_dir, getpid(), time(NULL));
+        
+        handle_upload(socket, content_len, save_path, body_start, initial_body_len);
+    } else {
+        send_response(socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>400 No Content-Length</h1></body></html>");
+    }
+}
+
+void handle_delete(struct Server *server, int socket, HttpRequest *request) {
+    (void)server;
+    char rel[PATH_MAX_LEN];
+    if (resolve_request_path(socket, request, rel, sizeof(rel)) < 0) return;
+    if (rel[0] == '\0') {
+         send_response(socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>Cannot delete root</h1></body></html>");
+         return;
+    }
+    if (path_unlink(rel) == 0) {
+        send_response(socket, HTTP_OK, "text/html", "<html><body><h1>File Deleted</h1></body></html>");
+    } else {
+        if (errno == ENOENT)
+            send_response(socket, HTTP_NOT_FOUND, "text/html", "<html><body><h1>404 Not Found</h1></body></html>");
+        else
+            send_response(socket, HTTP_FORBIDDEN, "text/html","<html><body><h1>403 Forbidden</h1></body></html>");
+    }
+}
+
+void handle_metrics(struct Server *server, int socket, HttpRequest *request) {
+    (void)request;
+    StatsTotals totals;
+    stats_sum(stats_shared, &totals);
+
+    char body[512];
+    snprintf(body, sizeof(body),
+        "uptime_seconds %ld\n"
+        "worker_pid %d\n"
+        "worker_requests %lu\n"
+        "worker_cpu %d\n"
+        "cache_entries %d\n"
+        "cache_hits %lu\n"
+        "inflight %d\n"
+        "shed_total %lu\n"
+        "requests_total %lu\n"
+        "errors_total %lu\n"
+        "bytes_in_total %llu\n"
+        "bytes_out_total %llu\n"
+        "active_connections %ld\n",
+        (long)(time(NULL) - server->started_at), getpid(), worker_requests, worker_cpu,
+        content_cache.count, cache_total_hits(),
+        server->admission.state ? server->admission.state->inflight : 0,
+        server->admission.state ? server->admission.state->shed_total : 0,
+        totals.requests, totals.errors, totals.bytes_in, totals.bytes_out, totals.active);
+    send_response(socket, HTTP_OK, "text/plain", body);
+}
+
+void handle_health(struct Server *server, int socket, HttpRequest *request) {
+    (void)server;
+    (void)request;
+    send_response(socket, HTTP_OK, "text/plain", "OK");
+}
+
+void handle_trace(struct Server *server, int socket, HttpRequest *request) {
+    (void)server;
+    (void)request;
+    static char body[TRACE_RING_SIZE * 256];
+    trace_dump_ring(body, sizeof(body));
+    send_response(socket, HTTP_OK, "text/plain", body);
+}
+
+static int is_priority_request(struct Server *server, HttpRequest *request) {
+    request->method_id = http_method_parse(request->method);
+    return router_lookup(&server->router, request->method_id, request->path, NULL) == handle_health;
+}
+
+/* Looks at the request line without consuming it. Runs in the accept loop on the
+   shedding path, so it never waits: a request line that has not arrived yet is shed
+   (defer_accept makes it very likely to be there already). */
+static int peek_priority_request(struct Server *server, int socket) {
+    char peek[320];
+    ssize_t n = recv(socket, peek, sizeof(peek) - 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n <= 0) return 0;
+    peek[n] = '\0';
+
+    HttpRequest request = {0};
+    if (sscanf(peek, "%15s %255s", request.method, request.path) < 2) return 0;
+    return is_priority_request(server, &request);
+}
+
+static void dispatch_request(struct Server *server, int socket, HttpRequest *request) {
+    worker_requests++;
+    request->method_id = http_method_parse(request->method);
+
+    RouteHandler handler = router_lookup(&server->router, request->method_id, request->path, &request->route_arg);
+    if (!handler && request->method_id == HTTP_METHOD_OPTIONS && strcmp(request->path, "*") == 0) handler = handle_options;
+    if (handler) {
+        handler(server, socket, request);
+    } else {
+        send_response(socket, HTTP_NOT_IMPLEMENTED, "text/html", "<html><body><h1>501 Not Implemented</h1></body></html>");
+    }
+}
+
+/* Every per-connection socket option lives here. Runs in the worker, so the
+   setsockopt() calls never hold up the accept loop. */
+static void configure_client_socket(struct Server *server, const Listener *listener, int socket) {
+    int flags = fcntl(socket, F_GETFL);
+    if (flags >= 0) fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
+
+    struct timeval tv;
+    tv.tv_sec = server->config.keep_alive_timeout;
+    tv.tv_usec = 0;
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+
+    int opt = 1;
+    if (listener->family == AF_UNIX) return;
+    if (server->config.tcp_nodelay) setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    if (server->config.tcp_keepalive) setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
+    if (server->config.sndbuf > 0) setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &server->config.sndbuf, sizeof(int));
+    if (server->config.rcvbuf > 0) setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &server->config.rcvbuf, sizeof(int));
+}
+
+/* Books a finished request into the shared counters and the access log. */
+static void record_request(const struct sockaddr_storage *peer, const HttpRequest *request, const TraceRecord *record) {
+    if (!record) return;
+    stats_request(record->status, record->received_bytes, record->sent_bytes);
+    if (access_log_enabled())
+        access_log_write(peer, http_method_parse(request->method), request->path,
+                         record->status, record->sent_bytes, trace_total_us(record));
+}
+
+static void handle_connection(struct Server *server, const Listener *listener, int new_socket, long long accepted_at) {
     char buffer[BUFFER_SIZE];
-    int addrlen = sizeof(server->address);
 
-    logger_init(server->config.log_file);
-    printf("=== SERVER STARTED on %s:%d ===\n", server->config.ip_address, server->config.port);
+    configure_client_socket(server, listener, new_socket);
+    trace_install_signal();
+    trace_recorder.client_fd = new_socket;
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(new_socket, (struct sockaddr *)&peer, &peer_len) < 0) peer.ss_family = AF_UNSPEC;
+
+    /* Pipelined requests can share a read: whatever follows the current request
+       stays in buffer and is parsed on the next round. */
+    size_t have = 0;
+    long long first_byte_at = 0;
+    int shed_candidate = admission_check_delay(&server->admission, accepted_at);
+    buffer[0] = '\0';
+    while(1) {
+        char *head_end = memmem(buffer, have, "\r\n\r\n", 4);
+        if (!head_end) {
+            if (have == BUFFER_SIZE - 1) break;
+            ssize_t bytesRead = read(new_socket, buffer + have, BUFFER_SIZE - 1 - have);
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) break;
+            if (have == 0) first_byte_at = monotonic_us();
+            have += bytesRead;
+            buffer[have] = '\0';
+            continue;
+        }
+
+        if (server->config.h2c && h2_is_preface(buffer, have)) {
+            h2_serve(server, new_socket, &peer, buffer, have, NULL, 0);
+            break;
+        }
+        if (server->config.h2c && h2_wants_upgrade(buffer)) {
+            h2_serve(server, new_socket, &peer, NULL, 0, buffer, have);
+            break;
+        }
+
+        /* The request ends after its Content-Length body; a chunked body is read by its
+           handler, so nothing after it can be kept. */
+        size_t request_len = head_end - buffer + 4;
+        char saved = buffer[request_len], value[32];
+        buffer[request_len] = '\0';
+        if (http_header_value(buffer, "Transfer-Encoding", value, sizeof(value))) {
+            request_len = have;
+        } else if (http_header_value(buffer, "Content-Length", value, sizeof(value))) {
+            long long body = atoll(value) > 0 ? atoll(value) : 0;
+            request_len = (long long)(have - request_len) > body ? request_len + body : have;
+        }
+        buffer[head_end - buffer + 4] = saved;
+        saved = buffer[request_len];
+        buffer[request_len] = '\0';
+
+        HttpRequest request = {0};
+        request.buffer = buffer;
+        request.length = request_len;
+        request.peer = &peer;
+        if (sscanf(buffer, "%15s %255s %15s", request.method, request.path, request.proto) < 2) break;
+
+        trace_begin(accepted_at, first_byte_at, request.method, request.path);
+        trace_received(new_socket, request_len);
+        accepted_at = 0;
 
-    while (1) {
-        int new_socket = accept(server->socket, (struct sockaddr*)&server->address, (socklen_t*)&addrlen);
-        if (new_socket < 0) continue;
+        if (!access_log_enabled())
+            LOG_INFO("[PID:%d] Request: %s %s", getpid(), request.method, request.path);
 
-        pid_t pid = fork();
+        if (shed_candidate) {
+            shed_candidate = 0;
+            if (!is_priority_request(server, &request)) {
+                LOG_WARN("[PID:%d] Shedding %s %s: queueing delay above target", getpid(), request.method, request.path);
+                admission_shed(&server->admission, new_socket);
+                trace_status(HTTP_SERVICE_UNAVAILABLE);
+                record_request(&peer, &request, trace_end());
+                break;
+            }
+        }
+
+        dispatch_request(server, new_socket, &request);
+        record_request(&peer, &request, trace_end());
+
+        if (request.close_connection || strstr(buffer, "Connection: close") || stats_draining()) {
+            break;
+        }
+        buffer[request_len] = saved;
+        have -= request_len;
+        memmove(buffer, buffer + request_len, have + 1);
+        first_byte_at = monotonic_us();
+    }
+}
+
+/* Serves one request whose head is already in buffer; a body, if any, is still to be
+   read from socket. Used by HTTP/2 stream workers with one end of a socketpair. */
+void serve_buffered_request(struct Server *server, int socket, char *buffer, ssize_t length,
+                            const struct sockaddr_storage *peer) {
+    HttpRequest request = {0};
+    request.buffer = buffer;
+    request.length = length;
+    request.peer = peer;
+    if (sscanf(buffer, "%15s %255s %15s", request.method, request.path, request.proto) < 2) return;
+
+    trace_recorder.client_fd = socket;
+    trace_begin(0, monotonic_us(), request.method, request.path);
+    trace_received(socket, length);
+    if (!access_log_enabled())
+        LOG_INFO("[PID:%d] Request: %s %s (h2)", getpid(), request.method, request.path);
+    dispatch_request(server, socket, &request);
+    record_request(peer, &request, trace_end());
+}
 
-        if (pid < 0) {
+static void serve_accepted(struct Server *server, const Listener *listener, int new_socket, long long accepted_at) {
+    server->accepted_total++;
+
+    if (admission_over_limit(&server->admission) && !peek_priority_request(server, new_socket)) {
+        admission_shed(&server->admission, new_socket);
+        close(new_socket);
+        return;
+    }
+
+    admission_enter(&server->admission);
+    access_log_refresh();
+    pid_t pid = fork();
+
+    if (pid < 0) {
         LOG_ERROR("Failed to fork process");
-        send_response(new_socket, HTTP_SERVICE_UNAVAILABLE, "text/html", "<h1>503 Service Unavailable</h1>");
+        admission_leave(&server->admission);
+        admission_shed(&server->admission, new_socket);
         close(new_socket);
-        continue;
-        }
+        return;
+    }
+
+    if (pid == 0) {
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGCHLD, SIG_IGN);
+        worker_cpu = affinity_place_worker(&server->affinity, new_socket, server->accepted_total);
+        for (int i = 0; i < server->listener_count; i++) close(server->listeners[i].fd);
+        close(server->epoll_fd);
+        stats_worker_attach();
+
+        handle_connection(server, listener, new_socket, accepted_at);
+
+        close(new_socket);
+        stats_worker_detach();
+        exit(0);
+    }
+
+    close(new_socket);
+    if (server->worker_count == server->worker_capacity) {
+        int capacity = server->worker_capacity ? server->worker_capacity * 2 : 64;
+        pid_t *workers = realloc(server->workers, capacity * sizeof(pid_t));
+        if (!workers) return;
+        server->workers = workers;
+        server->worker_capacity = capacity;
+    }
+    server->workers[server->worker_count++] = pid;
+}
 
-        if (pid == 0) {
-            close(server->socket);
-
-            struct timeval tv;
-            tv.tv_sec = server->config.keep_alive_timeout;
-            tv.tv_usec = 0;
-            setsockopt(new_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
-
-            while(1) {
-                memset(buffer, 0, BUFFER_SIZE);
-
-                ssize_t bytesRead = read(new_socket, buffer, BUFFER_SIZE - 1);
-                if (bytesRead <= 0) break; 
-                
-                buffer[bytesRead] = '\0';
-
-                char method[16] = {0}, path[256] = {0}, proto[16] = {0};
-                if (sscanf(buffer, "%s %s %s", method, path, proto) < 2) break;
-
-                LOG_INFO("[PID:%d] Request: %s %s", getpid(), method, path);
-
-                if (strcmp(method, "GET") == 0) {
-                    char file_path[512];
-                    if (strcmp(path, "/") == 0)
-                        snprintf(file_path, sizeof(file_path), "%s/index.html", server->config.root_dir);
-                    else {
-                        if (strstr(path, "..")) {
-                            send_response(new_socket, HTTP_FORBIDDEN, "text/html", "<html><body><h1>403 Forbidden</h1></body></html>");
-                            continue;
-                        }
-                        snprintf(file_path, sizeof(file_path), "%s%s", server->config.root_dir, path);
-                    }
-                    send_file_stream(new_socket, file_path);
-                } 
-                else if (strcmp(method, "POST") == 0) {
-                    long content_len = 0;
-                    char *len_str = strstr(buffer, "Content-Length: ");
-                    if (len_str) sscanf(len_str, "Content-Length: %ld", &content_len);
-
-                    char *body_start = strstr(buffer, "\r\n\r\n");
-                    int initial_body_len = 0;
-                    if (body_start) {
-                        body_start += 4;
-                        initial_body_len = bytesRead - (body_start - buffer);
-                    } else {
-                        body_start = NULL; 
-                    }
-
-                    if (content_len > 0) {
-                        char save_path[512];
-                        snprintf(save_path, sizeof(save_path), "%s/upload_%d_%ld.bin", 
-                            server->config.storage_dir, getpid(), time(NULL));
-                        
-                        handle_upload(new_socket, content_len, save_path, body_start, initial_body_len);
-                    } else {
-                        send_response(new_socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>400 No Content-Length</h1></body></html>");
-                    }
-                }
-                else if (strcmp(method, "DELETE") == 0) {
-                    char file_path[512];
-                    if (strcmp(path, "/") == 0) {
-                         send_response(new_socket, HTTP_BAD_REQUEST, "text/html", "<html><body><h1>Cannot delete root</h1></body></html>");
-                    } else {
-                        if (strstr(path, "..")) {
-                            send_response(new_socket, HTTP_FORBIDDEN, "text/html", "<html><body><h1>403 Forbidden</h1></body></html>");
-                            continue; 
-                        }
-                        snprintf(file_path, sizeof(file_path), "%s%s", server->config.root_dir, path);
-                        if (remove(file_path) == 0) {
-                            send_response(new_socket, HTTP_OK, "text/html", "<html><body><h1>File Deleted</h1></body></html>");
-                        } else {
-                            if (errno == ENOENT)
-                                send_response(new_socket, HTTP_NOT_FOUND, "text/html", "<html><body><h1>404 Not Found</h1></body></html>");
-                            else
-                                send_response(new_socket, HTTP_FORBIDDEN, "text/html","<html><body><h1>403 Forbidden</h1></body></html>");
-                        }
-                    }
-                }
-                else {
-                    send_response(new_socket, HTTP_NOT_IMPLEMENTED, "text/html", "<html><body><h1>501 Not Implemented</h1></body></html>");
-                }
-                if (strstr(buffer, "Connection: close")) {
-                    break;
-                }
+/* The master gives back a worker's inflight slot when it reaps it, so a worker
+   killed by a signal cannot leak the slot the way an exit-time decrement would. */
+static void reap_workers(struct Server *server) {
+    pid_t pid;
+    workers_exited = 0;
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        if (pid == server->proxy_keeper) {
+            LOG_WARN("Proxy pool keeper exited: upstream connections are no longer pooled");
+            server->proxy_keeper = 0;
+            continue;
+        }
+        admission_leave(&server->admission);
+        for (int i = 0; i < server->worker_count; i++) {
+            if (server->workers[i] == pid) {
+                server->workers[i] = server->workers[--server->worker_count];
+                break;
             }
-            close(new_socket);
-            exit(0);
-        } 
-        else {
-            close(new_socket);
         }
     }
 }
 
+/* SIGUSR1 to the master: every connection worker appends its ring to trace_dump.
+   Workers are only removed once reaped, so none of these pids can have been reused. */
+static void forward_trace_dump(struct Server *server) {
+    trace_dump_requested = 0;
+    for (int i = 0; i < server->worker_count; i++) kill(server->workers[i], SIGUSR1);
+}
+
+/* Drains the listen queue: one readiness event accepts up to accept_batch connections. */
+static void accept_batch(struct Server *server, const Listener *listener) {
+    for (int i = 0; i < server->config.accept_batch; i++) {
+        int new_socket = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (new_socket < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED)
+                LOG_ERROR("accept4 failed: %s", strerror(errno));
+            return;
+        }
+        serve_accepted(server, listener, new_socket, monotonic_us());
+    }
+}
+
+void launch(struct Server *server) {
+    logger_init(server->config.log_file);
+    if (server->config.master_cpu >= 0 && affinity_pin_self(server->config.master_cpu) < 0) {
+        LOG_WARN("Cannot pin master to CPU %d", server->config.master_cpu);
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->epoll_fd < 0) {
+        LOG_FATAL("Failed to set up epoll");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < server->listener_count; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listeners[i].fd, &ev) < 0) {
+            LOG_FATAL("Failed to watch listener %s", server->listeners[i].spec);
+            exit(EXIT_FAILURE);
+        }
+        printf("=== SERVER STARTED on %s ===\n", server->listeners[i].spec);
+    }
+
+    /* With the shared control block the loop wakes up twice a second to see a drain request. */
+    struct epoll_event events[16];
+    int timeout = stats_shared ? 500 : -1;
+    while (!server_stopping && !stats_draining()) {
+        int ready = epoll_wait(server->epoll_fd, events, 16, timeout);
+        if (workers_exited) reap_workers(server);
+        if (trace_dump_requested) forward_trace_dump(server);
+        for (int i = 0; i < ready; i++) {
+            accept_batch(server, &server->listeners[events[i].data.u32]);
+        }
+    }
+
+    for (int i = 0; i < server->listener_count; i++) listener_close(&server->listeners[i]);
+
+    if (stats_draining()) {
+        LOG_INFO("Draining: no longer accepting, waiting for workers");
+        while (!server_stopping && server->admission.state &&
+               __atomic_load_n(&server->admission.state->inflight, __ATOMIC_RELAXED) > 0) {
+            usleep(50000);
+            reap_workers(server);
+        }
+    }
+
+    if (server->config.preload && server->config.preload_manifest[0] != '\0') {
+        if (cache_save_manifest(server->config.preload_manifest) == 0)
+            LOG_INFO("Saved hot asset manifest to %s", server->config.preload_manifest);
+    }
+    LOG_INFO("Server stopped");
+}
+
+void preload_assets(const ServerConfig *config) {
+    if (cache_init((size_t)config->preload_max_mb * 1024 * 1024) < 0) {
+        LOG_WARN("Content cache hit counters unavailable");
+    }
+    if (!config->preload) return;
+
+    long long started = monotonic_us();
+    int hot = config->preload_manifest[0] ? cache_preload_manifest(config->preload_manifest) : 0;
+    int walked = cache_preload_dir(config->root_dir, config->storage_dir, config->gzip_cache_dir);
+
+    int compressed = 0;
+    for (int i = 0; config->gzip && i < content_cache.count; i++) {
+        CacheEntry *entry = &content_cache.entries[i];
+        if (mime_lookup(entry->path)->compressible && entry->size >= (size_t)config->gzip_min_size &&
+            cache_compress(entry, config->gzip_level) == 0)
+            compressed++;
+    }
+    content_cache.shared_count = content_cache.count;
+
+    LOG_INFO("Preloaded %d hot + %d other assets (%zu bytes, %d gzipped) in %lld ms",
+             hot, walked, content_cache.bytes, compressed, (monotonic_us() - started) / 1000);
+}
+
 ServerConfig load_config(const char *filename) {
     ServerConfig config;
     config.port = 8080;
@@ -321,6 +947,37 @@ ServerConfig load_config(const char *filename) {
     strcpy(config.storage_dir, "./uploads");
     strcpy(config.ip_address, "0.0.0.0");
     strcpy(config.log_file, "");
+    config.max_inflight = 512;
+    config.admission_target_ms = 5;
+    config.admission_interval_ms = 100;
+    config.trace_slow_ms = 1000;
+    strcpy(config.trace_dump, "trace_dump.log");
+    config.route_count = 0;
+    config.upstream_count = 0;
+    config.proxy_rule_count = 0;
+    config.proxy_timeout = 30;
+    strcpy(config.worker_affinity, "off");
+    config.master_cpu = -1;
+    config.preload = 0;
+    config.preload_max_mb = 64;
+    strcpy(config.preload_manifest, "");
+    config.accept_batch = 64;
+    config.tcp_nodelay = 1;
+    config.tcp_keepalive = 0;
+    config.sndbuf = 0;
+    config.rcvbuf = 0;
+    config.defer_accept = 0;
+    config.tcp_fastopen = 0;
+    config.gzip = 1;
+    config.gzip_level = 6;
+    config.gzip_min_size = 256;
+    strcpy(config.gzip_cache_dir, "./gzip_cache");
+    config.listen_count = 0;
+    strcpy(config.access_log, "off");
+    config.access_log_segment_mb = 64;
+    config.path_cache_ttl_ms = 1000;
+    config.h2c = 1;
+    config.stats_shm[0] = '\0';
 
     FILE *f = fopen(filename, "r");
     if (!f) return config;
@@ -329,6 +986,33 @@ ServerConfig load_config(const char *filename) {
     while (fgets(line, sizeof(line), f)) {
         line[strcspn(line, "\r\n")] = 0;
         char key[50], val[200];
+        if (strncmp(line, "route=", 6) == 0) {
+            if (config.route_count < MAX_ROUTES) {
+                RouteSpec *spec = &config.routes[config.route_count];
+                if (sscanf(line + 6, "%15s %127s %31s", spec->method, spec->pattern, spec->handler) == 3)
+                    config.route_count++;
+            }
+            continue;
+        }
+        if (strncmp(line, "listen=", 7) == 0) {
+            if (config.listen_count < MAX_LISTENERS) {
+                if (snprintf(config.listen[config.listen_count], sizeof(config.listen[0]), "%s", line + 7) < (int)sizeof(config.listen[0]))
+                    config.listen_count++;
+                else
+                    LOG_ERROR("Listen address too long, ignored: %s", line + 7);
+            }
+            continue;
+        }
+        if (strncmp(line, "upstream=", 9) == 0) {
+            if (config.upstream_count < MAX_UPSTREAMS && proxy_parse_upstream(line + 9, &config.upstreams[config.upstream_count]) == 0)
+                config.upstream_count++;
+            continue;
+        }
+        if (strncmp(line, "proxy=", 6) == 0) {
+            if (config.proxy_rule_count < MAX_PROXY_RULES && proxy_parse_rule(line + 6, &config.proxy_rules[config.proxy_rule_count]) == 0)
+                config.proxy_rule_count++;
+            continue;
+        }
         if (sscanf(line, "%[^=]=%s", key, val) == 2) {
             if (strcmp(key, "port") == 0) config.port = atoi(val);
             if (strcmp(key, "root_dir") == 0) strcpy(config.root_dir, val);
@@ -337,6 +1021,41 @@ ServerConfig load_config(const char *filename) {
             if (strcmp(key, "max_clients") == 0) config.backlog = atoi(val);
             if (strcmp(key, "log_file") == 0) strcpy(config.log_file, val);
             if (strcmp(key, "keep_alive_timeout") == 0) config.keep_alive_timeout = atoi(val);
+            if (strcmp(key, "max_inflight") == 0) config.max_inflight = atoi(val);
+            if (strcmp(key, "admission_target_ms") == 0) config.admission_target_ms = atoi(val);
+            if (strcmp(key, "admission_interval_ms") == 0) config.admission_interval_ms = atoi(val);
+            if (strcmp(key, "trace_slow_ms") == 0) config.trace_slow_ms = atoi(val);
+            if (strcmp(key, "trace_dump") == 0) strcpy(config.trace_dump, val);
+            if (strcmp(key, "proxy_timeout") == 0) config.proxy_timeout = atoi(val);
+            if (strcmp(key, "worker_affinity") == 0 &&
+                snprintf(config.worker_affinity, sizeof(config.worker_affinity), "%s", val) >= (int)sizeof(config.worker_affinity)) {
+                LOG_ERROR("worker_affinity too long, ignored: %s", val);
+                strcpy(config.worker_affinity, "off");
+            }
+            if (strcmp(key, "master_cpu") == 0) config.master_cpu = atoi(val);
+            if (strcmp(key, "preload") == 0) config.preload = strcmp(val, "on") == 0 || strcmp(val, "1") == 0;
+            if (strcmp(key, "preload_max_mb") == 0) config.preload_max_mb = atoi(val);
+            if (strcmp(key, "preload_manifest") == 0) strcpy(config.preload_manifest, val);
+            if (strcmp(key, "accept_batch") == 0) config.accept_batch = atoi(val) > 0 ? atoi(val) : 1;
+            if (strcmp(key, "tcp_nodelay") == 0) config.tcp_nodelay = atoi(val);
+            if (strcmp(key, "tcp_keepalive") == 0) config.tcp_keepalive = atoi(val);
+            if (strcmp(key, "sndbuf") == 0) config.sndbuf = atoi(val);
+            if (strcmp(key, "rcvbuf") == 0) config.rcvbuf = atoi(val);
+            if (strcmp(key, "defer_accept") == 0) config.defer_accept = atoi(val);
+            if (strcmp(key, "tcp_fastopen") == 0) config.tcp_fastopen = atoi(val);
+            if (strcmp(key, "gzip") == 0) config.gzip = strcmp(val, "on") == 0 || strcmp(val, "1") == 0;
+            if (strcmp(key, "gzip_level") == 0) config.gzip_level = atoi(val);
+            if (strcmp(key, "gzip_min_size") == 0) config.gzip_min_size = atoi(val);
+            if (strcmp(key, "gzip_cache_dir") == 0) snprintf(config.gzip_cache_dir, sizeof(config.gzip_cache_dir), "%s", val);
+            if (strcmp(key, "access_log") == 0) snprintf(config.access_log, sizeof(config.access_log), "%s", val);
+            if (strcmp(key, "access_log_segment_mb") == 0) config.access_log_segment_mb = atoi(val);
+            if (strcmp(key, "path_cache_ttl_ms") == 0) config.path_cache_ttl_ms = atoi(val);
+            if (strcmp(key, "stats_shm") == 0 &&
+                snprintf(config.stats_shm, sizeof(config.stats_shm), "%s", val) >= (int)sizeof(config.stats_shm)) {
+                LOG_ERROR("stats_shm name too long, using the default: %s", val);
+                config.stats_shm[0] = '\0';
+            }
+            if (strcmp(key, "h2c") == 0) config.h2c = strcmp(val, "on") == 0 || strcmp(val, "1") == 0;
         }
     }
     fclose(f);
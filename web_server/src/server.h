@@ -1,6 +1,22 @@
 #ifndef server_h
 #define server_h
 #include <netinet/in.h>
+#include <sys/types.h>
+#include <time.h>
+#include "router.h"
+#include "admission.h"
+#include "trace.h"
+#include "proxy.h"
+#include "affinity.h"
+#include "cache.h"
+#include "mime.h"
+#include "compress.h"
+#include "listener.h"
+#include "accesslog.h"
+#include "path.h"
+#include "h2.h"
+#include "stats.h"
+#include <signal.h>
 #define BUFFER_SIZE 16000
 
 typedef enum {
@@ -14,11 +30,13 @@ typedef enum {
 typedef enum {
     HTTP_OK = 200,
     HTTP_CREATED = 201,
+    HTTP_NO_CONTENT = 204,
     HTTP_BAD_REQUEST = 400,
     HTTP_FORBIDDEN = 403,
     HTTP_NOT_FOUND = 404,
     HTTP_INTERNAL_SERVER_ERROR = 500,
     HTTP_NOT_IMPLEMENTED = 501,
+    HTTP_BAD_GATEWAY = 502,
     HTTP_SERVICE_UNAVAILABLE = 503
 } HttpStatusCode;
 
@@ -30,21 +48,103 @@ typedef struct{
     char ip_address[32];
     char log_file[256];
     int keep_alive_timeout;
+    int max_inflight;
+    int admission_target_ms;
+    int admission_interval_ms;
+    int trace_slow_ms;
+    char trace_dump[256];
+    RouteSpec routes[MAX_ROUTES];
+    int route_count;
+    Upstream upstreams[MAX_UPSTREAMS];
+    int upstream_count;
+    ProxyRule proxy_rules[MAX_PROXY_RULES];
+    int proxy_rule_count;
+    int proxy_timeout;
+    char worker_affinity[64];
+    int master_cpu;
+    int preload;
+    int preload_max_mb;
+    char preload_manifest[256];
+    int accept_batch;
+    int tcp_nodelay;
+    int tcp_keepalive;
+    int sndbuf;
+    int rcvbuf;
+    int defer_accept;
+    int tcp_fastopen;
+    int gzip;
+    int gzip_level;
+    int gzip_min_size;
+    char gzip_cache_dir[256];
+    char listen[MAX_LISTENERS][128];
+    int listen_count;
+    char access_log[256];
+    int access_log_segment_mb;
+    int path_cache_ttl_ms;
+    int h2c;
+    char stats_shm[64];
 } ServerConfig;
 
+typedef struct HttpRequest {
+    HttpMethod method_id;
+    int route_arg;
+    char method[16];
+    char path[256];
+    char proto[16];
+    char *buffer;
+    ssize_t length;
+    int close_connection;
+    const struct sockaddr_storage *peer; /* the client, also for h2 streams served over a socketpair */
+} HttpRequest;
+
 struct Server {
     ServerConfig config;
-    int socket;
-    struct sockaddr_in address;
+    Listener listeners[MAX_LISTENERS];
+    int listener_count;
+    int epoll_fd;
+    Router router;
+    AdmissionControl admission;
+    ProxyShared *proxy_shared;
+    pid_t proxy_keeper;     /* holds idle upstream connections; not a worker */
+    AffinityPlan affinity;
+    unsigned long accepted_total;
+    pid_t *workers;     /* live connection workers, so the master can forward SIGUSR1 */
+    int worker_count;
+    int worker_capacity;
+    time_t started_at;
+    char options_response[192];
+    int options_length;
 
     void (*launch)(struct Server *server);
 };
 
+extern volatile sig_atomic_t server_stopping;
+extern volatile sig_atomic_t workers_exited;
+extern volatile sig_atomic_t trace_dump_requested;
+
 struct Server server_Constructor(ServerConfig config, void (*launch)(struct Server *server));
 void launch(struct Server *server);
 ServerConfig load_config(const char *filename);
+void preload_assets(const ServerConfig *config);
 void send_response(int socket, HttpStatusCode status_code, char *content_type, char *body);
+void send_file_stream(struct Server *server, int socket, const char *rel_path, int accept_gzip);
+int write_all(int fd, const void *data, size_t len);
+const char *http_header_value(const char *head, const char *name, char *out, size_t size);
 void handle_upload(int socket, long content_length, const char *filename, char *initial_data, int initial_len);
+void serve_buffered_request(struct Server *server, int socket, char *buffer, ssize_t length,
+                            const struct sockaddr_storage *peer);
+
+void handle_static(struct Server *server, int socket, HttpRequest *request);
+void handle_head(struct Server *server, int socket, HttpRequest *request);
+void handle_options(struct Server *server, int socket, HttpRequest *request);
+void handle_post(struct Server *server, int socket, HttpRequest *request);
+void handle_delete(struct Server *server, int socket, HttpRequest *request);
+void handle_metrics(struct Server *server, int socket, HttpRequest *request);
+void handle_health(struct Server *server, int socket, HttpRequest *request);
+void handle_trace(struct Server *server, int socket, HttpRequest *request);
+void handle_proxy(struct Server *server, int socket, HttpRequest *request);
+
+long long monotonic_us(void);
 
 void logger_init(const char *filename);
 void log_message(LogLevel level, const char *file, int line, const char *format, ...);
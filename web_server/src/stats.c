@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stats.h"
+
+StatsShared *stats_shared = NULL;
+
+static StatsSlot *worker_slot = NULL;
+
+/* A leftover segment whose master is still alive belongs to a running server. */
+static int stats_owner_alive(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(StatsControl)) {
+        p = mmap(NULL, sizeof(StatsControl), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    pid_t owner = __atomic_load_n(&((StatsControl *)p)->master_pid, __ATOMIC_RELAXED);
+    munmap(p, sizeof(StatsControl));
+    return owner > 0 && (kill(owner, 0) == 0 || errno == EPERM);
+}
+
+/* Called from main() once the listeners are bound and before the first worker forks;
+   every worker inherits the mapping. Returns -2 if a running server owns the name.
+   A stale segment is unlinked rather than truncated, so workers a crashed master
+   left behind keep their own mapping instead of faulting on a shrunken one. */
+int stats_create(const char *name) {
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        if (stats_owner_alive(name)) return -2;
+        shm_unlink(name);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0) return -1;
+    if (ftruncate(fd, sizeof(StatsShared)) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    void *p = mmap(NULL, sizeof(StatsShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    stats_shared = p;
+    stats_shared->control.master_pid = getpid();
+    stats_shared->control.slot_count = STATS_MAX_SLOTS;
+    stats_shared->control.config_generation = 1;
+    stats_shared->control.started_at = time(NULL);
+    __atomic_store_n(&stats_shared->control.magic, STATS_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* For readers such as tools/wsstat; the server itself uses stats_shared. */
+StatsShared *stats_open(const char *name, int writable) {
+    int fd = shm_open(name, writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    void *p = mmap(NULL, sizeof(StatsShared), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    StatsShared *shared = p;
+    if (__atomic_load_n(&shared->control.magic, __ATOMIC_ACQUIRE) != STATS_MAGIC) {
+        munmap(p, sizeof(StatsShared));
+        return NULL;
+    }
+    return shared;
+}
+
+void stats_destroy(const char *name) {
+    if (!stats_shared) return;
+    munmap(stats_shared, sizeof(StatsShared));
+    stats_shared = NULL;
+    shm_unlink(name);
+}
+
+static int claim_slot(int index, pid_t owner) {
+    pid_t expected = owner;
+    pid_t self = getpid();
+    return __atomic_compare_exchange_n(&stats_shared->slots[index].pid, &expected, self, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/* Takes a free slot, starting at pid % slots so concurrent workers rarely probe the
+   same ones. Slots left behind by a crashed worker are reclaimed when none is free
+   (only on ESRCH: EPERM means the owner is alive); if every slot is busy the worker
+   shares one, which the atomic adds allow. */
+void stats_worker_attach(void) {
+    if (!stats_shared) return;
+    pid_t self = getpid();
+    int start = self % STATS_MAX_SLOTS;
+
+    worker_slot = NULL;
+    for (int i = 0; i < STATS_MAX_SLOTS && !worker_slot; i++) {
+        int index = (start + i) % STATS_MAX_SLOTS;
+        if (claim_slot(index, 0)) worker_slot = &stats_shared->slots[index];
+    }
+    for (int i = 0; i < STATS_MAX_SLOTS && !worker_slot; i++) {
+        int index = (start + i) % STATS_MAX_SLOTS;
+        pid_t owner = __atomic_load_n(&stats_shared->slots[index].pid, __ATOMIC_RELAXED);
+        if (owner > 0 && kill(owner, 0) < 0 && errno == ESRCH && claim_slot(index, owner)) {
+            __atomic_store_n(&stats_shared->slots[index].active, 0, __ATOMIC_RELAXED);
+            worker_slot = &stats_shared->slots[index];
+        }
+    }
+    if (!worker_slot) worker_slot = &stats_shared->slots[start];
+    __atomic_add_fetch(&worker_slot->active, 1, __ATOMIC_RELAXED);
+}
+
+void stats_worker_detach(void) {
+    if (!worker_slot) return;
+    __atomic_sub_fetch(&worker_slot->active, 1, __ATOMIC_RELAXED);
+    pid_t self = getpid();
+    __atomic_compare_exchange_n(&worker_slot->pid, &self, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    worker_slot = NULL;
+}
+
+/* Errors are responses the server failed to produce: status 5xx. */
+void stats_request(int status, unsigned long long bytes_in, unsigned long long bytes_out) {
+    if (!worker_slot) return;
+    __atomic_add_fetch(&worker_slot->requests, 1, __ATOMIC_RELAXED);
+    if (status >= 500) __atomic_add_fetch(&worker_slot->errors, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&worker_slot->bytes_in, bytes_in, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&worker_slot->bytes_out, bytes_out, __ATOMIC_RELAXED);
+}
+
+void stats_sum(const StatsShared *shared, StatsTotals *totals) {
+    memset(totals, 0, sizeof(*totals));
+    for (int i = 0; shared && i < STATS_MAX_SLOTS; i++) {
+        const StatsSlot *slot = &shared->slots[i];
+        totals->requests += __atomic_load_n(&slot->requests, __ATOMIC_RELAXED);
+        totals->errors += __atomic_load_n(&slot->errors, __ATOMIC_RELAXED);
+        totals->bytes_in += __atomic_load_n(&slot->bytes_in, __ATOMIC_RELAXED);
+        totals->bytes_out += __atomic_load_n(&slot->bytes_out, __ATOMIC_RELAXED);
+        totals->active += __atomic_load_n(&slot->active, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&slot->pid, __ATOMIC_RELAXED) > 0) totals->workers++;
+    }
+}
+
+int stats_draining(void) {
+    return stats_shared && __atomic_load_n(&stats_shared->control.drain, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,57 @@
+#ifndef stats_h
+#define stats_h
+
+#include <sys/types.h>
+
+#define STATS_MAGIC 0x57535431u
+#define STATS_MAX_SLOTS 256
+#define STATS_CACHE_LINE 64
+
+/* Written by the master; the CLI may set drain. */
+typedef struct {
+    unsigned int magic;
+    unsigned int slot_count;
+    pid_t master_pid;
+    int drain;
+    unsigned long config_generation;
+    long started_at;
+} __attribute__((aligned(STATS_CACHE_LINE))) StatsControl;
+
+/* Claimed by one connection worker at a time (pid), but counters are never reset:
+   a slot keeps adding up across the workers that used it, so nothing is lost when
+   a worker exits. Each slot has its own cache line, so workers never share one. */
+typedef struct {
+    pid_t pid;
+    unsigned long requests;
+    unsigned long errors;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    long active;
+} __attribute__((aligned(STATS_CACHE_LINE))) StatsSlot;
+
+typedef struct {
+    StatsControl control;
+    StatsSlot slots[STATS_MAX_SLOTS];
+} StatsShared;
+
+typedef struct {
+    unsigned long requests;
+    unsigned long errors;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    long active;
+    int workers;
+} StatsTotals;
+
+extern StatsShared *stats_shared;
+
+int stats_create(const char *name);
+StatsShared *stats_open(const char *name, int writable);
+void stats_destroy(const char *name);
+void stats_worker_attach(void);
+void stats_worker_detach(void);
+void stats_request(int status, unsigned long long bytes_in, unsigned long long bytes_out);
+void stats_sum(const StatsShared *shared, StatsTotals *totals);
+int stats_draining(void);
+
+#endif
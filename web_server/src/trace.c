@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "server.h"
+#include "trace.h"
+
+TraceRecorder trace_recorder;
+
+static const char *STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "accept", "first_byte", "headers", "file_open", "upload_done", "last_byte"
+};
+
+void trace_init(long long slow_us, const char *dump_path) {
+    memset(&trace_recorder, 0, sizeof(trace_recorder));
+    trace_recorder.client_fd = -1;
+    trace_recorder.slow_us = slow_us;
+    if (dump_path) snprintf(trace_recorder.dump_path, sizeof(trace_recorder.dump_path), "%s", dump_path);
+}
+
+void trace_begin(long long accepted_at, long long first_byte_at, const char *method, const char *path) {
+    TraceRecord *record = &trace_recorder.ring[trace_recorder.head % TRACE_RING_SIZE];
+    trace_recorder.head++;
+
+    memset(record, 0, sizeof(*record));
+    record->stamps[TRACE_ACCEPT] = accepted_at;
+    record->stamps[TRACE_FIRST_BYTE] = first_byte_at;
+    record->stamps[TRACE_HEADERS_PARSED] = monotonic_us();
+    strncpy(record->method, method, sizeof(record->method) - 1);
+    strncpy(record->path, path, sizeof(record->path) - 1);
+    trace_recorder.current = record;
+}
+
+void trace_upload(long bytes) {
+    if (!trace_recorder.current) return;
+    trace_recorder.current->upload_bytes = bytes;
+    trace_recorder.current->stamps[TRACE_UPLOAD_DONE] = monotonic_us();
+}
+
+static long long trace_base(const TraceRecord *record) {
+    return record->stamps[TRACE_ACCEPT] ? record->stamps[TRACE_ACCEPT] : record->stamps[TRACE_FIRST_BYTE];
+}
+
+long long trace_total_us(const TraceRecord *record) {
+    return record->stamps[TRACE_LAST_BYTE] ? record->stamps[TRACE_LAST_BYTE] - trace_base(record) : -1;
+}
+
+/* trace_format also runs in the SIGUSR1 handler, so it formats by hand instead of
+   using snprintf, which is not async-signal-safe. Both append and stop at size - 1. */
+static int put_str(char *out, int len, int size, const char *s) {
+    while (*s && len < size - 1) out[len++] = *s++;
+    return len;
+}
+
+static int put_num(char *out, int len, int size, long long value) {
+    char digits[24];
+    int n = 0;
+    unsigned long long v = value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (value < 0 && len < size - 1) out[len++] = '-';
+    while (n > 0 && len < size - 1) out[len++] = digits[--n];
+    return len;
+}
+
+int trace_format(const TraceRecord *record, char *out, int size) {
+    long long base = trace_base(record);
+    int len = put_str(out, 0, size, "[trace] pid=");
+    len = put_num(out, len, size, getpid());
+    len = put_str(out, len, size, " ");
+    len = put_str(out, len, size, record->method);
+    len = put_str(out, len, size, " ");
+    len = put_str(out, len, size, record->path);
+    len = put_str(out, len, size, " status=");
+    len = put_num(out, len, size, record->status);
+    len = put_str(out, len, size, " total_us=");
+    len = put_num(out, len, size, trace_total_us(record));
+
+    for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+        if (record->stamps[i] == 0) continue;
+        len = put_str(out, len, size, " ");
+        len = put_str(out, len, size, STAGE_NAMES[i]);
+        len = put_str(out, len, size, "=+");
+        len = put_num(out, len, size, record->stamps[i] - base);
+    }
+    if (record->upload_bytes) {
+        len = put_str(out, len, size, " upload_bytes=");
+        len = put_num(out, len, size, record->upload_bytes);
+    }
+    len = put_str(out, len, size, "\n");
+    out[len] = '\0';
+    return len;
+}
+
+const TraceRecord *trace_end(void) {
+    TraceRecord *record = trace_recorder.current;
+    if (!record) return NULL;
+    record->stamps[TRACE_LAST_BYTE] = monotonic_us();
+    trace_recorder.current = NULL;
+
+    if (trace_recorder.slow_us > 0 && record->stamps[TRACE_LAST_BYTE] - trace_base(record) >= trace_recorder.slow_us) {
+        char line[512];
+        trace_format(record, line, sizeof(line));
+        line[strcspn(line, "\n")] = 0;
+        LOG_WARN("Slow request %s", line);
+    }
+    return record;
+}
+
+/* Oldest record first. Returns the number of bytes written to out. */
+int trace_dump_ring(char *out, int size) {
+    unsigned int head = trace_recorder.head;
+    unsigned int count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    int len = 0;
+
+    for (unsigned int i = head - count; i != head && len < size - 1; i++) {
+        len += trace_format(&trace_recorder.ring[i % TRACE_RING_SIZE], out + len, size - len);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/* Only async-signal-safe calls: open, write, close and trace_format. The record
+   being filled when the signal lands may come out half-written. */
+static void trace_signal_handler(int sig) {
+    (void)sig;
+    if (trace_recorder.dump_path[0] == '\0') return;
+
+    int fd = open(trace_recorder.dump_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return;
+
+    unsigned int head = trace_recorder.head;
+    unsigned int count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    char line[512];
+    for (unsigned int i = head - count; i != head; i++) {
+        int len = trace_format(&trace_recorder.ring[i % TRACE_RING_SIZE], line, sizeof(line));
+        if (write(fd, line, len) < 0) break;
+    }
+    close(fd);
+}
+
+void trace_install_signal(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = trace_signal_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+}
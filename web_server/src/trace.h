@@ -0,0 +1,61 @@
+#ifndef trace_h
+#define trace_h
+
+#define TRACE_RING_SIZE 256
+
+typedef enum {
+    TRACE_ACCEPT = 0,
+    TRACE_FIRST_BYTE,
+    TRACE_HEADERS_PARSED,
+    TRACE_FILE_OPENED,
+    TRACE_UPLOAD_DONE,
+    TRACE_LAST_BYTE,
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+/* Timestamps are CLOCK_MONOTONIC microseconds, 0 means the stage was not reached. */
+typedef struct {
+    long long stamps[TRACE_STAGE_COUNT];
+    long upload_bytes;
+    unsigned long long sent_bytes;
+    unsigned long long received_bytes;
+    int status;
+    char method[8];
+    char path[64];
+} TraceRecord;
+
+/* Per-worker flight recorder. Each forked worker owns its copy, so writes
+   never need atomics or locks. */
+typedef struct {
+    TraceRecord ring[TRACE_RING_SIZE];
+    unsigned int head;
+    TraceRecord *current;
+    int client_fd;
+    long long slow_us;
+    char dump_path[256];
+} TraceRecorder;
+
+extern TraceRecorder trace_recorder;
+
+void trace_init(long long slow_us, const char *dump_path);
+void trace_install_signal(void);
+void trace_begin(long long accepted_at, long long first_byte_at, const char *method, const char *path);
+const TraceRecord *trace_end(void);
+void trace_upload(long bytes);
+long long trace_total_us(const TraceRecord *record);
+int trace_format(const TraceRecord *record, char *out, int size);
+int trace_dump_ring(char *out, int size);
+
+#define trace_stamp(stage) \
+    do { if (trace_recorder.current) trace_recorder.current->stamps[stage] = monotonic_us(); } while (0)
+
+#define trace_status(code) \
+    do { if (trace_recorder.current) trace_recorder.current->status = (code); } while (0)
+
+#define trace_sent(fd, n) \
+    do { if (trace_recorder.current && (fd) == trace_recorder.client_fd) trace_recorder.current->sent_bytes += (n); } while (0)
+
+#define trace_received(fd, n) \
+    do { if (trace_recorder.current && (fd) == trace_recorder.client_fd) trace_recorder.current->received_bytes += (n); } while (0)
+
+#endif
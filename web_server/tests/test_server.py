@@ -5,6 +5,11 @@ import requests
 import os
 import shutil
 import socket
+import signal
+import gzip
+import glob
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 
 TEST_DIR = os.path.dirname(os.path.abspath(__file__))
 PROJECT_ROOT = os.path.dirname(TEST_DIR)
@@ -15,6 +20,13 @@ BASE_URL = f"http://{TEST_HOST}:{TEST_PORT}"
 TEST_CONF_FILE = os.path.join(TEST_DIR, "server.conf")
 TEST_UPLOAD_DIR = os.path.join(TEST_DIR, "uploads")
 TEST_LOG_FILE = "server_test.log"
+TEST_MANIFEST = os.path.join(TEST_DIR, "preload.manifest")
+TEST_SOCKET = os.path.join(TEST_DIR, "server.sock")
+TEST_ACCESS_LOG = os.path.join(TEST_DIR, "access")
+TEST_GZIP_CACHE = os.path.join(TEST_DIR, "gzip_cache")
+ALOG_BIN = os.path.join(PROJECT_ROOT, "tools", "alog")
+WSSTAT_BIN = os.path.join(PROJECT_ROOT, "tools", "wsstat")
+BACKEND_PORTS = (8093, 8094)
 
 @pytest.fixture(scope="class", autouse=True)
 def setup_server_class(request):
@@ -26,6 +38,23 @@ ip={TEST_HOST}
 max_clients=10
 log_file={TEST_LOG_FILE}
 keep_alive_timeout=2
+route=GET /ping health
+route=GET /debug/trace trace
+max_inflight=8
+upstream=api 127.0.0.1:{BACKEND_PORTS[0]},127.0.0.1:{BACKEND_PORTS[1]} rr
+upstream=dead 127.0.0.1:1
+proxy=/api/ api
+proxy=/dead/ dead
+worker_affinity=incoming
+preload=on
+preload_manifest=preload.manifest
+defer_accept=1
+tcp_fastopen=16
+listen={TEST_HOST}:{TEST_PORT}
+listen=[::1]:{TEST_PORT}
+listen=unix:{TEST_SOCKET}
+access_log=access
+access_log_segment_mb=1
 """
     with open(TEST_CONF_FILE, "w") as f:
         f.write(config_content.strip())
@@ -46,6 +75,7 @@ keep_alive_timeout=2
         stdout=subprocess.DEVNULL,
         stderr=subprocess.DEVNULL
     )
+    request.cls.server_pid = server_process.pid
 
     timeout = 2
     start_time = time.time()
@@ -67,8 +97,16 @@ keep_alive_timeout=2
         os.remove(os.path.join(TEST_DIR, "index.html"))
     if os.path.exists(TEST_CONF_FILE):
         os.remove(TEST_CONF_FILE)
+    if os.path.exists(TEST_MANIFEST):
+        os.remove(TEST_MANIFEST)
+    if os.path.exists(TEST_SOCKET):
+        os.remove(TEST_SOCKET)
+    for segment in glob.glob(f"{TEST_ACCESS_LOG}.*.bin"):
+        os.remove(segment)
     if os.path.exists(TEST_UPLOAD_DIR):
         shutil.rmtree(TEST_UPLOAD_DIR)
+    if os.path.exists(TEST_GZIP_CACHE):
+        shutil.rmtree(TEST_GZIP_CACHE)
 
 # ==========================================
 #      POSITIVE SCENARIOS (Happy Path)
@@ -93,6 +131,81 @@ class TestPositiveScenarios:
         
         os.remove(os.path.join(TEST_DIR, "style.css"))
 
+    def test_content_type_by_extension(self):
+        """[Positive] Content-Type comes from the file extension."""
+        path = os.path.join(TEST_DIR, "app.JS")
+        with open(path, "w") as f:
+            f.write("console.log(1);")
+        try:
+            response = requests.get(f"{BASE_URL}/app.JS")
+            assert response.headers["Content-Type"] == "text/javascript; charset=utf-8"
+        finally:
+            os.remove(path)
+
+    def test_gzip_on_the_fly(self):
+        """[Positive] Compressible files are gzipped when the client accepts it."""
+        content = "body { margin: 0; padding: 0; }\n" * 200
+        path = os.path.join(TEST_DIR, "big.css")
+        with open(path, "w") as f:
+            f.write(content)
+        try:
+            response = requests.get(f"{BASE_URL}/big.css", headers={"Accept-Encoding": "gzip"})
+            assert response.headers.get("Content-Encoding") == "gzip"
+            assert int(response.headers["Content-Length"]) < len(content)
+            assert response.text == content
+
+            response = requests.get(f"{BASE_URL}/big.css", headers={"Accept-Encoding": "identity"})
+            assert "Content-Encoding" not in response.headers
+            assert response.text == content
+        finally:
+            os.remove(path)
+
+    def test_gzip_copy_outlives_worker(self):
+        """[Positive] A body gzipped on the fly is kept on disk for later connections, until the file changes."""
+        content = "p { color: red; }\n" * 300
+        path = os.path.join(TEST_DIR, "shared.css")
+        with open(path, "w") as f:
+            f.write(content)
+        try:
+            before = set(glob.glob(os.path.join(TEST_GZIP_CACHE, "*.gz")))
+            assert requests.get(f"{BASE_URL}/shared.css", headers={"Accept-Encoding": "gzip"}).text == content
+            copies = set(glob.glob(os.path.join(TEST_GZIP_CACHE, "*.gz"))) - before
+            assert len(copies) == 1
+            copy = copies.pop()
+            with gzip.open(copy, "rt") as f:
+                assert f.read() == content
+
+            response = requests.get(f"{BASE_URL}/shared.css", headers={"Accept-Encoding": "gzip"})
+            assert response.headers.get("Content-Encoding") == "gzip"
+            assert int(response.headers["Content-Length"]) == os.path.getsize(copy)
+            assert response.text == content
+
+            time.sleep(1.1)  # past path_cache_ttl_ms
+            with open(path, "w") as f:
+                f.write(content.replace("red", "blue"))
+            response = requests.get(f"{BASE_URL}/shared.css", headers={"Accept-Encoding": "gzip"})
+            assert response.text == content.replace("red", "blue")
+        finally:
+            os.remove(path)
+
+    def test_precompressed_sibling(self):
+        """[Positive] file.gz is served as-is to gzip clients."""
+        path = os.path.join(TEST_DIR, "pre.txt")
+        with open(path, "w") as f:
+            f.write("plain version")
+        with gzip.open(path + ".gz", "wb") as f:
+            f.write(b"precompressed version")
+        try:
+            response = requests.get(f"{BASE_URL}/pre.txt", headers={"Accept-Encoding": "gzip, deflate"})
+            assert response.headers.get("Content-Encoding") == "gzip"
+            assert response.text == "precompressed version"
+
+            response = requests.get(f"{BASE_URL}/pre.txt", headers={"Accept-Encoding": "gzip;q=0"})
+            assert response.text == "plain version"
+        finally:
+            os.remove(path)
+            os.remove(path + ".gz")
+
     def test_upload_file_post(self):
         """[Positive] Uploading a file via POST."""
         for f in os.listdir(TEST_UPLOAD_DIR):
@@ -124,6 +237,180 @@ class TestPositiveScenarios:
         assert response.status_code == 200
         assert not os.path.exists(filepath)
 
+    def test_health_route(self):
+        """[Positive] Built-in health route."""
+        response = requests.get(f"{BASE_URL}/health")
+        assert response.status_code == 200
+        assert response.text == "OK"
+
+    def test_configured_route(self):
+        """[Positive] Route added via server.conf."""
+        response = requests.get(f"{BASE_URL}/ping?probe=1")
+        assert response.status_code == 200
+        assert response.text == "OK"
+
+    def test_metrics_route(self):
+        """[Positive] Metrics endpoint."""
+        response = requests.get(f"{BASE_URL}/metrics")
+        assert response.status_code == 200
+        assert "worker_requests" in response.text
+
+    def test_head_request(self):
+        """[Positive] HEAD returns the GET headers without a body, then keep-alive continues."""
+        get = requests.get(f"{BASE_URL}/index.html", headers={"Accept-Encoding": "identity"})
+        with socket.create_connection((TEST_HOST, TEST_PORT)) as sock:
+            sock.settimeout(2)
+            sock.sendall(b"HEAD /index.html HTTP/1.1\r\nHost: test\r\n\r\n")
+            head = sock.recv(4096)
+            assert head.startswith(b"HTTP/1.1 200 OK")
+            assert f"Content-Length: {len(get.content)}".encode() in head
+            assert head.endswith(b"\r\n\r\n")
+
+            sock.sendall(b"HEAD /missing.html HTTP/1.1\r\nHost: test\r\n\r\n")
+            head = sock.recv(4096)
+            assert head.startswith(b"HTTP/1.1 404 Not Found")
+            assert head.endswith(b"\r\n\r\n")
+
+            sock.sendall(b"GET /health HTTP/1.1\r\nHost: test\r\n\r\n")
+            assert sock.recv(4096).startswith(b"HTTP/1.1 200 OK")
+
+    def test_options_request(self):
+        """[Positive] OPTIONS answers with the routed methods."""
+        for target in ("/index.html", "*"):
+            with socket.create_connection((TEST_HOST, TEST_PORT)) as sock:
+                sock.settimeout(2)
+                sock.sendall(f"OPTIONS {target} HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n".encode())
+                data = sock.recv(4096)
+            assert data.startswith(b"HTTP/1.1 204 No Content")
+            assert b"Allow: GET, POST, DELETE, HEAD, OPTIONS" in data
+
+    def test_connection_burst(self):
+        """[Positive] A burst of simultaneous connections is drained in one accept batch."""
+        time.sleep(0.3)
+        socks = [socket.create_connection((TEST_HOST, TEST_PORT)) for _ in range(6)]
+        try:
+            for sock in socks:
+                sock.sendall(b"GET /health HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n")
+            for sock in socks:
+                sock.settimeout(2)
+                assert sock.recv(64).startswith(b"HTTP/1.1 200 OK")
+        finally:
+            for sock in socks:
+                sock.close()
+
+    def test_pipelined_requests(self):
+        """[Positive] Requests pipelined in one write are all answered, in order."""
+        upload = b"POST / HTTP/1.1\r\nHost: test\r\nContent-Length: 5\r\n\r\nhello"
+        with socket.create_connection((TEST_HOST, TEST_PORT), timeout=2) as sock:
+            sock.sendall(b"GET /health HTTP/1.1\r\nHost: test\r\n\r\n" + upload +
+                         b"GET /index.html HTTP/1.1\r\nHost: test\r\n\r\n"
+                         b"GET /ghost_file.html HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n")
+            data = b""
+            while chunk := sock.recv(65536):
+                data += chunk
+        assert [s.split()[0] for s in data.split(b"HTTP/1.1 ")[1:]] == [b"200", b"201", b"200", b"404"]
+        assert b"<h1>Unit Test Index</h1>" in data
+
+    def test_preloaded_asset_cache(self):
+        """[Positive] index.html is preloaded and served from the cache, edits are picked up."""
+        def metrics():
+            text = requests.get(f"{BASE_URL}/metrics").text
+            return {k: int(v) for k, v in (l.split() for l in text.splitlines())}
+
+        before = metrics()
+        assert before["cache_entries"] > 0
+        assert requests.get(f"{BASE_URL}/").text == "<h1>Unit Test Index</h1>"
+        assert metrics()["cache_hits"] == before["cache_hits"] + 1
+
+        index = os.path.join(TEST_DIR, "index.html")
+        with open(index, "w") as f:
+            f.write("<h1>Edited Index</h1>")
+        try:
+            assert requests.get(f"{BASE_URL}/").text == "<h1>Edited Index</h1>"
+        finally:
+            with open(index, "w") as f:
+                f.write("<h1>Unit Test Index</h1>")
+
+    def test_worker_pinned_to_cpu(self):
+        """[Positive] worker_affinity=incoming pins the worker to one CPU."""
+        with requests.Session() as s:
+            metrics = dict(l.split() for l in s.get(f"{BASE_URL}/metrics").text.splitlines())
+            with open(f"/proc/{metrics['worker_pid']}/status") as f:
+                status = dict(l.split(":", 1) for l in f.read().splitlines() if ":" in l)
+
+        assert int(metrics["worker_cpu"]) >= 0
+        assert status["Cpus_allowed_list"].strip() == metrics["worker_cpu"]
+
+    def test_shared_worker_stats(self):
+        """[Positive] Counters of finished workers survive in the shared block."""
+        before = wsstat()
+        for _ in range(3):
+            assert requests.get(f"{BASE_URL}/index.html").status_code == 200
+        time.sleep(0.1)
+        after = wsstat()
+        assert after["requests_total"] >= before["requests_total"] + 3
+        assert after["bytes_out_total"] > before["bytes_out_total"]
+        assert after["bytes_in_total"] > before["bytes_in_total"]
+        assert after["draining"] == 0
+
+    def test_second_instance_leaves_stats_alone(self):
+        """[Negative] An instance that cannot bind the port exits without resetting the running server's block."""
+        assert requests.get(f"{BASE_URL}/health").status_code == 200
+        before = wsstat()
+        second = subprocess.run([SERVER_BIN], cwd=TEST_DIR, capture_output=True, timeout=10)
+        assert second.returncode != 0
+
+        after = wsstat()
+        assert after["master_pid"] == self.server_pid
+        assert after["requests_total"] >= before["requests_total"] > 0
+        assert requests.get(f"{BASE_URL}/health").status_code == 200
+
+        metrics = dict(l.split() for l in requests.get(f"{BASE_URL}/metrics").text.splitlines())
+        assert int(metrics["requests_total"]) >= after["requests_total"]
+        assert int(metrics["active_connections"]) >= 1
+
+    def test_query_string_and_dot_segments(self):
+        """[Positive] The query is ignored and ./ or // segments are normalized."""
+        s = requests.Session()
+        prepped = requests.Request('GET', f"{BASE_URL}/x").prepare()
+        prepped.url = f"{BASE_URL}/.//index.html?v=2"
+        response = s.send(prepped)
+        assert response.status_code == 200
+        assert "Unit Test Index" in response.text
+
+    def test_ipv6_listener(self):
+        """[Positive] The same content is served on the IPv6 loopback listener."""
+        response = requests.get(f"http://[::1]:{TEST_PORT}/health")
+        assert response.status_code == 200
+
+    def test_unix_socket_listener(self):
+        """[Positive] Requests over the Unix-domain listener are served."""
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+            sock.connect(TEST_SOCKET)
+            sock.sendall(b"GET /health HTTP/1.1\r\nHost: local\r\nConnection: close\r\n\r\n")
+            response = b""
+            while chunk := sock.recv(4096):
+                response += chunk
+        assert response.startswith(b"HTTP/1.1 200")
+
+    def test_binary_access_log(self):
+        """[Positive] Requests land in the binary access log and the decoder aggregates them."""
+        with requests.Session() as s:
+            for _ in range(5):
+                assert s.get(f"{BASE_URL}/ping").status_code == 200
+            assert s.get(f"{BASE_URL}/missing.txt").status_code == 404
+
+        segments = sorted(glob.glob(f"{TEST_ACCESS_LOG}.*.bin"))
+        assert segments
+        report = subprocess.run([ALOG_BIN, "-n", "10", *segments], capture_output=True, text=True, check=True).stdout
+        stats = dict(l.split(" ", 1) for l in report.splitlines() if " " in l and not l.startswith(" "))
+        assert int(stats["records"]) >= 6
+        assert int(stats["status_4xx"]) >= 1
+        assert "/ping" in report
+
+        dump = subprocess.run([ALOG_BIN, "-d", *segments], capture_output=True, text=True, check=True).stdout
+        assert "127.0.0.1 GET /missing.txt 404" in dump
+
 
 # ==========================================
 #      NEGATIVE SCENARIOS (Error Handling)
@@ -160,6 +447,22 @@ class TestNegativeScenarios:
         response = s.send(prepped)
         assert response.status_code == 403
 
+    def test_encoded_directory_traversal(self):
+        """[Negative] Percent-encoded traversal is decoded before the check."""
+        s = requests.Session()
+        prepped = requests.Request('GET', f"{BASE_URL}/x").prepare()
+        prepped.url = f"{BASE_URL}/%2e%2e/%2E%2E/Makefile"
+        assert s.send(prepped).status_code == 403
+
+    def test_symlink_out_of_root(self):
+        """[Negative] A symlink pointing outside root_dir is not followed."""
+        link = os.path.join(TEST_DIR, "escape")
+        os.symlink(PROJECT_ROOT, link)
+        try:
+            assert requests.get(f"{BASE_URL}/escape/Makefile").status_code == 404
+        finally:
+            os.remove(link)
+
     def test_post_without_content_length(self):
         """[Negative] POST без Content-Length."""
         s = requests.Session()
@@ -169,4 +472,396 @@ class TestNegativeScenarios:
             del prepped.headers['Content-Length']
             
         response = s.send(prepped)
-        assert response.status_code == 400
\ No newline at end of file
+        assert response.status_code == 400
+
+
+# ==========================================
+#      REQUEST TRACING (Flight Recorder)
+# ==========================================
+class TestRequestTracing:
+
+    def test_trace_ring_dump(self):
+        """[Trace] Flight recorder keeps every request of the worker."""
+        with requests.Session() as s:
+            assert s.get(f"{BASE_URL}/").status_code == 200
+            assert s.get(f"{BASE_URL}/ghost_file.html").status_code == 404
+            response = s.get(f"{BASE_URL}/debug/trace")
+
+        assert response.status_code == 200
+        lines = response.text.splitlines()
+        assert any("GET / status=200" in l and "file_open=" in l for l in lines)
+        assert any("GET /ghost_file.html status=404" in l for l in lines)
+
+    def test_sigusr1_to_master_dumps_worker_rings(self):
+        """[Trace] SIGUSR1 to the master makes every live connection worker dump its ring."""
+        dump = os.path.join(TEST_DIR, "trace_dump.log")
+        if os.path.exists(dump):
+            os.remove(dump)
+        try:
+            with requests.Session() as s:
+                assert s.get(f"{BASE_URL}/index.html").status_code == 200
+                os.kill(self.server_pid, signal.SIGUSR1)
+                time.sleep(0.3)
+            with open(dump) as f:
+                lines = f.read().splitlines()
+            assert any("GET /index.html status=200 total_us=" in l and "last_byte=+" in l for l in lines)
+        finally:
+            if os.path.exists(dump):
+                os.remove(dump)
+
+
+# ==========================================
+#      ADMISSION CONTROL (Load Shedding)
+# ==========================================
+def worker_pids(master):
+    """Children of the master, except the proxy pool keeper."""
+    pids = []
+    for stat in glob.glob("/proc/[0-9]*/stat"):
+        try:
+            with open(stat) as f:
+                comm, rest = f.read().split("(", 1)[1].rsplit(")", 1)
+        except OSError:
+            continue
+        if int(rest.split()[1]) == master and comm != "proxy-pool":
+            pids.append(int(stat.split("/")[2]))
+    return pids
+
+
+class TestAdmissionControl:
+
+    def test_shed_when_inflight_limit_reached(self):
+        """[Overload] Requests over max_inflight get 503, health checks still pass."""
+        time.sleep(0.3)
+        idle = []
+        for _ in range(8):
+            sock = socket.create_connection((TEST_HOST, TEST_PORT))
+            sock.sendall(b"GET /health HTTP/1.1\r\nHost: test\r\n\r\n")
+            idle.append(sock)
+        time.sleep(0.3)
+        try:
+            response = requests.get(f"{BASE_URL}/index.html")
+            assert response.status_code == 503
+            assert response.headers.get("Retry-After") == "1"
+
+            response = requests.get(f"{BASE_URL}/health")
+            assert response.status_code == 200
+        finally:
+            for sock in idle:
+                sock.close()
+
+        time.sleep(0.3)
+        response = requests.get(f"{BASE_URL}/")
+        assert response.status_code == 200
+
+    def test_killed_workers_release_their_slot(self):
+        """[Overload] Workers killed by a signal give their inflight slot back."""
+        for _ in range(2):
+            idle = []
+            for _ in range(8):
+                sock = socket.create_connection((TEST_HOST, TEST_PORT))
+                sock.sendall(b"GET /health HTTP/1.1\r\nHost: test\r\n\r\n")
+                idle.append(sock)
+            time.sleep(0.3)
+            for pid in worker_pids(self.server_pid):
+                os.kill(pid, signal.SIGKILL)
+            for sock in idle:
+                sock.close()
+
+        time.sleep(0.3)
+        response = requests.get(f"{BASE_URL}/")
+        assert response.status_code == 200
+
+
+
+# ==========================================
+#      REVERSE PROXY (Stand-in Backends)
+# ==========================================
+class BackendHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def _reply(self, body):
+        self.send_response(200)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        if self.path == "/api/chunked":
+            self.send_response(200)
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for part in (b"hello ", b"chunked ", b"world"):
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(part), part))
+            self.wfile.write(b"0\r\n\r\n")
+            return
+        port = self.server.server_address[1]
+        self._reply(f"backend={port} path={self.path} peer={self.client_address[1]} "
+                    f"xff={self.headers.get('X-Forwarded-For')}".encode())
+
+    def do_POST(self):
+        if self.headers.get("Transfer-Encoding") != "chunked":
+            body = self.rfile.read(int(self.headers["Content-Length"]))
+            self._reply(f"received={len(body)} sum={sum(body)}".encode())
+            return
+        body = b""
+        while size := int(self.rfile.readline().split(b";")[0], 16):
+            body += self.rfile.read(size)
+            self.rfile.readline()
+        while self.rfile.readline() not in (b"\r\n", b""):
+            pass
+        self._reply(f"received={len(body)} chunked cl={self.headers.get('Content-Length')}".encode())
+
+
+def raw_exchange(data):
+    """Sends data on a fresh connection and returns everything read until the server closes."""
+    with socket.create_connection((TEST_HOST, TEST_PORT), timeout=3) as sock:
+        sock.sendall(data)
+        reply = b""
+        while chunk := sock.recv(65536):
+            reply += chunk
+    return reply
+
+
+@pytest.fixture(scope="class")
+def backends():
+    servers = [ThreadingHTTPServer((TEST_HOST, port), BackendHandler) for port in BACKEND_PORTS]
+    for srv in servers:
+        threading.Thread(target=srv.serve_forever, daemon=True).start()
+    yield servers
+    for srv in servers:
+        srv.shutdown()
+        srv.server_close()
+
+
+@pytest.mark.usefixtures("backends")
+class TestReverseProxy:
+
+    def test_round_robin_with_pooled_connections(self):
+        """[Proxy] Requests alternate between backends and reuse upstream connections."""
+        with requests.Session() as s:
+            bodies = [s.get(f"{BASE_URL}/api/item{i}").text for i in range(4)]
+
+        fields = [dict(kv.split("=") for kv in b.split()) for b in bodies]
+        assert {f["backend"] for f in fields} == {str(p) for p in BACKEND_PORTS}
+        assert [f["path"] for f in fields] == [f"/api/item{i}" for i in range(4)]
+        for port in BACKEND_PORTS:
+            peers = {f["peer"] for f in fields if f["backend"] == str(port)}
+            assert len(peers) == 1, "upstream connection was not reused"
+
+    @pytest.mark.skipif(not shutil.which("curl"), reason="curl not installed")
+    def test_pool_outlives_client_connections(self):
+        """[Proxy] Upstream connections are reused across client connections and h2 streams."""
+        bodies = []
+        for i in range(6):
+            if i < 4:
+                bodies.append(requests.get(f"{BASE_URL}/api/fresh{i}", headers={"Connection": "close"}).text)
+            else:
+                bodies.append(h2_curl("--http2-prior-knowledge", f"{BASE_URL}/api/fresh{i}").stdout)
+            # The worker hands the connection back just after the client has its response.
+            time.sleep(0.05)
+
+        fields = [dict(kv.split("=") for kv in b.split()[:3]) for b in bodies]
+        assert {f["backend"] for f in fields} == {str(p) for p in BACKEND_PORTS}
+        for port in BACKEND_PORTS:
+            peers = {f["peer"] for f in fields if f["backend"] == str(port)}
+            assert len(peers) == 1, "upstream connection did not outlive the client connection"
+
+    def test_post_body_relay(self):
+        """[Proxy] Request bodies larger than one read are relayed intact."""
+        payload = bytes(range(256)) * 400
+        response = requests.post(f"{BASE_URL}/api/upload", data=payload)
+        assert response.status_code == 200
+        assert response.text == f"received={len(payload)} sum={sum(payload)}"
+
+    def test_chunked_response(self):
+        """[Proxy] Chunked upstream responses are forwarded."""
+        response = requests.get(f"{BASE_URL}/api/chunked")
+        assert response.status_code == 200
+        assert response.text == "hello chunked world"
+
+    @pytest.mark.skipif(not shutil.which("curl"), reason="curl not installed")
+    def test_chunked_response_over_h2(self):
+        """[Proxy] Chunked upstream responses are re-framed as HTTP/2 DATA."""
+        result = h2_curl("--http2-prior-knowledge", f"{BASE_URL}/api/chunked")
+        assert result.stdout == "hello chunked world\n2 200"
+
+    @pytest.mark.skipif(not shutil.which("curl"), reason="curl not installed")
+    def test_forwarded_for_over_h2(self):
+        """[Proxy] h2 streams forward the real client address, not the stream's socketpair."""
+        assert "xff=127.0.0.1" in requests.get(f"{BASE_URL}/api/item").text
+        result = h2_curl("--http2-prior-knowledge", f"{BASE_URL}/api/item")
+        assert "xff=127.0.0.1" in result.stdout
+
+    def test_chunked_request_drops_content_length(self):
+        """[Proxy] With both Transfer-Encoding and Content-Length, chunked wins and CL is not forwarded."""
+        reply = raw_exchange(b"POST /api/upload HTTP/1.1\r\nHost: test\r\nContent-Length: 4\r\n"
+                             b"Transfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n")
+        assert reply.startswith(b"HTTP/1.0 200") or reply.startswith(b"HTTP/1.1 200")
+        assert reply.endswith(b"received=5 chunked cl=None")
+
+    def test_unsupported_transfer_coding(self):
+        """[Proxy] Transfer codings other than chunked are refused with 501, not relayed."""
+        reply = raw_exchange(b"POST /api/upload HTTP/1.1\r\nHost: test\r\n"
+                             b"Transfer-Encoding: gzip, chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n")
+        assert reply.startswith(b"HTTP/1.1 501")
+        assert reply.count(b"HTTP/1.1 ") == 1
+
+    def test_malformed_chunk_size(self):
+        """[Proxy] Chunk sizes must be plain hex digits: "0x5" is not relayed."""
+        reply = raw_exchange(b"POST /api/upload HTTP/1.1\r\nHost: test\r\n"
+                             b"Transfer-Encoding: chunked\r\n\r\n0x5\r\nhello\r\n0\r\n\r\n")
+        assert b"received=" not in reply
+
+    def test_unreachable_backend(self):
+        """[Proxy] 502 when no backend accepts the connection."""
+        response = requests.get(f"{BASE_URL}/dead/anything")
+        assert response.status_code == 502
+
+    def test_non_proxied_paths_stay_local(self):
+        """[Proxy] Paths outside proxy prefixes are still served from root_dir."""
+        response = requests.get(f"{BASE_URL}/")
+        assert response.status_code == 200
+        assert "<h1>Unit Test Index</h1>" in response.text
+
+
+
+class TestWarmStartManifest:
+
+    def test_manifest_ranks_every_served_path(self):
+        """[Control] The manifest written on shutdown ranks served files, preloaded or not."""
+        late = os.path.join(TEST_DIR, "late.txt")
+        with open(late, "w") as f:
+            f.write("created after preload")
+        try:
+            for _ in range(3):
+                assert requests.get(f"{BASE_URL}/late.txt").status_code == 200
+            assert requests.get(f"{BASE_URL}/index.html").status_code == 200
+
+            os.kill(self.server_pid, signal.SIGTERM)
+            deadline = time.time() + 5
+            while not os.path.exists(TEST_MANIFEST) and time.time() < deadline:
+                time.sleep(0.05)
+            with open(TEST_MANIFEST) as f:
+                lines = [l.split() for l in f.read().splitlines()]
+        finally:
+            os.remove(late)
+
+        assert lines[0] == ["3", "./late.txt"]
+        assert ["1", "./index.html"] in lines
+
+
+class TestDrain:
+
+    def test_drain_stops_accepting(self):
+        """[Control] wsstat drain lets the open connection finish, then the server stops accepting."""
+        with requests.Session() as s:
+            assert s.get(f"{BASE_URL}/health").status_code == 200
+            subprocess.run([WSSTAT_BIN, "-p", str(TEST_PORT), "drain"], check=True, capture_output=True)
+            time.sleep(1)
+            assert s.get(f"{BASE_URL}/health").status_code == 200
+
+        time.sleep(1)
+        with pytest.raises(requests.ConnectionError):
+            requests.get(f"{BASE_URL}/health", timeout=1)
+
+
+# ==========================================
+#      HTTP/2 CLEARTEXT (h2c)
+# ==========================================
+def wsstat():
+    out = subprocess.run([WSSTAT_BIN, "-p", str(TEST_PORT)], capture_output=True, text=True, check=True).stdout
+    return {k: int(v) for k, v in (l.split() for l in out.splitlines())}
+
+
+def h2_curl(*args):
+    return subprocess.run(["curl", "-s", "-w", "\n%{http_version} %{http_code}", *args],
+                          capture_output=True, text=True, timeout=10)
+
+
+def h2_raw_request(fields):
+    """Sends one prior-knowledge request with literal, unindexed HPACK fields and
+    returns the (type, flags, stream, payload) frames received up to the end of stream 1."""
+    block = b"".join(b"\x00" + bytes([len(n)]) + n + bytes([len(v)]) + v for n, v in fields)
+    frames = []
+    with socket.create_connection((TEST_HOST, TEST_PORT), timeout=5) as sock:
+        sock.sendall(b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+                     + b"\x00\x00\x00\x04\x00\x00\x00\x00\x00"
+                     + len(block).to_bytes(3, "big") + b"\x01\x05\x00\x00\x00\x01" + block)
+        data = b""
+        while True:
+            while len(data) >= 9 and len(data) >= 9 + int.from_bytes(data[:3], "big"):
+                length = int.from_bytes(data[:3], "big")
+                frame = (data[3], data[4], int.from_bytes(data[5:9], "big"), data[9:9 + length])
+                frames.append(frame)
+                data = data[9 + length:]
+                if frame[2] == 1 and (frame[0] == 0x3 or frame[1] & 0x1):
+                    return frames
+            chunk = sock.recv(65536)
+            if not chunk:
+                return frames
+            data += chunk
+
+
+@pytest.mark.skipif(not shutil.which("curl"), reason="curl not installed")
+class TestHttp2:
+
+    @pytest.fixture(autouse=True)
+    def big_file(self):
+        path = os.path.join(TEST_DIR, "big.bin")
+        with open(path, "wb") as f:
+            f.write(os.urandom(300000))
+        yield path
+        os.remove(path)
+
+    def test_prior_knowledge(self):
+        """[h2c] A prior-knowledge HTTP/2 request is served by the static handler."""
+        result = h2_curl("--http2-prior-knowledge", f"{BASE_URL}/index.html")
+        assert result.stdout == "<h1>Unit Test Index</h1>\n2 200"
+
+    def test_upgrade(self):
+        """[h2c] Upgrade: h2c switches the connection and answers on stream 1."""
+        result = h2_curl("--http2", f"{BASE_URL}/index.html")
+        assert result.stdout == "<h1>Unit Test Index</h1>\n2 200"
+
+    def test_large_body_flow_control(self, big_file):
+        """[h2c] A body larger than the initial window arrives intact."""
+        out = subprocess.run(["curl", "-s", "--http2-prior-knowledge", f"{BASE_URL}/big.bin"],
+                             capture_output=True, timeout=10).stdout
+        with open(big_file, "rb") as f:
+            assert out == f.read()
+
+    def test_upload(self):
+        """[h2c] Request bodies are streamed to the upload handler."""
+        payload = os.urandom(100000)
+        result = subprocess.run(["curl", "-s", "--http2-prior-knowledge", "--data-binary", "@-",
+                                 "-w", "\n%{http_version} %{http_code}", f"{BASE_URL}/"],
+                                input=payload, capture_output=True, timeout=10)
+        assert result.stdout.endswith(b"2 201")
+        sizes = [os.path.getsize(os.path.join(TEST_UPLOAD_DIR, n)) for n in os.listdir(TEST_UPLOAD_DIR)]
+        assert len(payload) in sizes
+
+    def test_malformed_fields_reset_stream(self):
+        """[h2c] Fields that could smuggle lines into the HTTP/1.1 head get RST_STREAM PROTOCOL_ERROR."""
+        base = [(b":method", b"GET"), (b":scheme", b"http"), (b":authority", b"test")]
+        frames = h2_raw_request(base + [(b":path", b"/index.html")])
+        assert any(f[0] == 0x1 and f[2] == 1 for f in frames)
+
+        for fields in ([(b":path", b"/index.html"), (b"x-a", b"1\r\nContent-Length: 0\r\nX-Injected: yes")],
+                       [(b":path", b"/index.html"), (b"x-a", b"1\x00")],
+                       [(b":path", b"/index.html"), (b"X-A", b"1")],
+                       [(b":path", b"/index.html HTTP/1.1")]):
+            frames = h2_raw_request(base + fields)
+            assert (0x3, 0, 1, (1).to_bytes(4, "big")) in frames, fields
+
+    @pytest.mark.skipif(not shutil.which("nghttp"), reason="nghttp not installed")
+    def test_multiplexed_streams(self):
+        """[h2c] Several concurrent streams on one connection all complete."""
+        urls = [f"{BASE_URL}/index.html", f"{BASE_URL}/big.bin", f"{BASE_URL}/health", f"{BASE_URL}/missing"]
+        result = subprocess.run(["nghttp", "-nv", *urls], capture_output=True, text=True, timeout=10)
+        assert result.returncode == 0
+        statuses = [l.split(":status: ")[1] for l in result.stdout.splitlines() if ":status: " in l]
+        assert sorted(statuses) == ["200", "200", "200", "404"]
+        assert result.stdout.count("; END_STREAM") >= 2 * len(urls)
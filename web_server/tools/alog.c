@@ -0,0 +1,181 @@
+/* Offline reader for the binary access log (access_log=PREFIX).
+ *
+ *   alog [-n TOP] [-d] PREFIX.000000.bin ...
+ *
+ * Prints request count, status classes, latency percentiles and the TOP busiest
+ * paths over all given segments; -d also dumps every record as a text line. */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../src/accesslog.h"
+#include "latency.h"
+
+/* Same order as HttpMethod in src/router.h. */
+static const char *METHOD_NAMES[] = { "GET", "POST", "DELETE", "HEAD", "OPTIONS", "PUT", "PATCH" };
+
+typedef struct {
+    uint64_t hash;
+    unsigned long count;
+    unsigned long long latency_sum;
+    uint16_t path_len;
+    char path[ACCESS_LOG_PATH_MAX + 1];
+} PathStat;
+
+static struct {
+    unsigned long records;
+    unsigned long status_class[6];
+    unsigned long long bytes;
+    uint64_t first_us, last_us;
+    uint32_t latency_max;
+    unsigned long latency[LAT_BUCKETS];
+    PathStat *paths;
+    size_t path_cap, path_count;
+} stats;
+
+static PathStat *path_slot(PathStat *table, size_t cap, uint64_t hash) {
+    size_t i = hash & (cap - 1);
+    while (table[i].count && table[i].hash != hash) i = (i + 1) & (cap - 1);
+    return &table[i];
+}
+
+static void path_grow(void) {
+    size_t cap = stats.path_cap ? stats.path_cap * 2 : 4096;
+    PathStat *table = calloc(cap, sizeof(PathStat));
+    if (!table) {
+        perror("calloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < stats.path_cap; i++) {
+        if (stats.paths[i].count) *path_slot(table, cap, stats.paths[i].hash) = stats.paths[i];
+    }
+    free(stats.paths);
+    stats.paths = table;
+    stats.path_cap = cap;
+}
+
+static void account(const AccessRecord *r) {
+    stats.records++;
+    stats.status_class[r->status / 100 < 6 ? r->status / 100 : 0]++;
+    stats.bytes += r->bytes;
+    if (!stats.first_us || r->time_us < stats.first_us) stats.first_us = r->time_us;
+    if (r->time_us > stats.last_us) stats.last_us = r->time_us;
+    if (r->latency_us > stats.latency_max) stats.latency_max = r->latency_us;
+    stats.latency[latency_bucket(r->latency_us)]++;
+
+    if (stats.path_count * 2 >= stats.path_cap) path_grow();
+    PathStat *p = path_slot(stats.paths, stats.path_cap, r->path_hash);
+    if (!p->count) {
+        p->hash = r->path_hash;
+        p->path_len = r->path_len;
+        memcpy(p->path, r->path, ACCESS_LOG_PATH_MAX);
+        stats.path_count++;
+    }
+    p->count++;
+    p->latency_sum += r->latency_us;
+}
+
+static void dump(const AccessRecord *r) {
+    char addr[INET6_ADDRSTRLEN] = "-";
+    if (r->family == AF_INET || r->family == AF_INET6) inet_ntop(r->family, r->addr, addr, sizeof(addr));
+    else if (r->family == AF_UNIX) strcpy(addr, "unix");
+
+    time_t sec = r->time_us / 1000000;
+    struct tm tm;
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", gmtime_r(&sec, &tm));
+
+    printf("%s.%06luZ %s %s %.*s%s %u %llu %uus\n", when, (unsigned long)(r->time_us % 1000000), addr,
+           r->method < sizeof(METHOD_NAMES) / sizeof(METHOD_NAMES[0]) ? METHOD_NAMES[r->method] : "?",
+           (int)strnlen(r->path, ACCESS_LOG_PATH_MAX), r->path, r->path_len > ACCESS_LOG_PATH_MAX ? "..." : "",
+           r->status, (unsigned long long)r->bytes, r->latency_us);
+}
+
+static int read_segment(const char *file, int dump_records) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        perror(file);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(AccessRecord)) {
+        close(fd);
+        return 0;
+    }
+    const AccessRecord *records = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (records == MAP_FAILED) {
+        perror(file);
+        return -1;
+    }
+    madvise((void *)records, st.st_size, MADV_SEQUENTIAL);
+
+    size_t count = st.st_size / sizeof(AccessRecord);
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].commit != ACCESS_LOG_MAGIC) continue;
+        account(&records[i]);
+        if (dump_records) dump(&records[i]);
+    }
+    munmap((void *)records, st.st_size);
+    return 0;
+}
+
+static uint32_t percentile(double q) {
+    return latency_percentile(stats.latency, stats.records, stats.latency_max, q);
+}
+
+static int by_count_desc(const void *a, const void *b) {
+    const PathStat *pa = a, *pb = b;
+    return pa->count < pb->count ? 1 : pa->count > pb->count ? -1 : 0;
+}
+
+static void report(int top) {
+    printf("records %lu\n", stats.records);
+    if (!stats.records) return;
+    printf("span_seconds %.3f\n", (stats.last_us - stats.first_us) / 1e6);
+    printf("bytes %llu\n", stats.bytes);
+    for (int i = 1; i < 6; i++) printf("status_%dxx %lu\n", i, stats.status_class[i]);
+    printf("latency_us p50=%u p90=%u p99=%u p999=%u max=%u\n",
+           percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), stats.latency_max);
+
+    size_t n = 0;
+    for (size_t i = 0; i < stats.path_cap; i++) {
+        if (stats.paths[i].count) stats.paths[n++] = stats.paths[i];
+    }
+    qsort(stats.paths, n, sizeof(PathStat), by_count_desc);
+    printf("top_paths\n");
+    for (size_t i = 0; i < n && (int)i < top; i++) {
+        PathStat *p = &stats.paths[i];
+        printf("%10lu %8lluus %s%s\n", p->count, p->latency_sum / p->count, p->path,
+               p->path_len > ACCESS_LOG_PATH_MAX ? "..." : "");
+    }
+}
+
+int main(int argc, char **argv) {
+    int top = 10, dump_records = 0, opt;
+    while ((opt = getopt(argc, argv, "n:d")) != -1) {
+        if (opt == 'n') top = atoi(optarg);
+        else if (opt == 'd') dump_records = 1;
+        else {
+            fprintf(stderr, "usage: %s [-n TOP] [-d] SEGMENT...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc) {
+        fprintf(stderr, "usage: %s [-n TOP] [-d] SEGMENT...\n", argv[0]);
+        return 2;
+    }
+
+    int rc = 0;
+    for (int i = optind; i < argc; i++) {
+        if (read_segment(argv[i], dump_records) < 0) rc = 1;
+    }
+    report(top);
+    return rc;
+}
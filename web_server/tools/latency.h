@@ -0,0 +1,35 @@
+#ifndef latency_h
+#define latency_h
+
+#include <stdint.h>
+
+/* Log-linear latency histogram shared by tools/alog and tools/wsload: exact below 64us,
+   then 64 buckets per power of two (under 1.6% error), so percentiles need no sorting
+   however many samples there are. */
+#define LAT_SUB_BITS 6
+#define LAT_BUCKETS ((32 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+static inline int latency_bucket(uint32_t us) {
+    if (us < (1u << LAT_SUB_BITS)) return us;
+    int exp = 31 - __builtin_clz(us);
+    return ((exp - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + ((us >> (exp - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1));
+}
+
+static inline uint32_t latency_bucket_floor(int bucket) {
+    if (bucket < (1 << LAT_SUB_BITS)) return bucket;
+    int exp = (bucket >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    return (1u << exp) | ((uint32_t)(bucket & ((1 << LAT_SUB_BITS) - 1)) << (exp - LAT_SUB_BITS));
+}
+
+/* Lower bound of the bucket holding quantile q of count samples. */
+static inline uint32_t latency_percentile(const unsigned long *buckets, unsigned long count, uint32_t max, double q) {
+    unsigned long target = (unsigned long)(q * count);
+    unsigned long seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > target) return latency_bucket_floor(i);
+    }
+    return max;
+}
+
+#endif
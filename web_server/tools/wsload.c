@@ -0,0 +1,407 @@
+/* Closed-loop HTTP/1.1 load generator for the netns bench (bench/netbench.sh).
+ *
+ *   wsload [-c CONNS] [-d SECONDS] [-p DEPTH] [-k] [-t TIMEOUT_MS] [-o FILE] HOST:PORT [PATH]
+ *   wsload -m FILE...
+ *
+ * Each connection keeps DEPTH requests in flight (pipelined when DEPTH > 1). Without -k
+ * every request opens its own connection, so the handshake is part of the latency.
+ * At the end of the run no new requests are sent and those in flight get -t to finish;
+ * any still unanswered then, or lost with a closed connection, count as errors.
+ * Prints throughput and latency percentiles; -o also saves the raw counters so -m can
+ * merge the runs of several load generators into one report. */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "latency.h"
+
+#define MAX_CONNS 4096
+#define MAX_DEPTH 64
+#define READ_BUFFER 65536
+
+typedef struct {
+    int fd;
+    int connected;
+    long long opened_at;
+    int inflight;
+    int head_done;
+    int status;
+    long long body_left;
+    long long sent_at[MAX_DEPTH];
+    int sent_head;
+    char *wbuf;
+    size_t wlen, woff;
+    char rbuf[READ_BUFFER];
+    size_t rlen;
+} Conn;
+
+/* Written as-is by -o and read back by -m, so only runs of the same build are merged. */
+typedef struct {
+    unsigned long requests;
+    unsigned long errors;
+    unsigned long timeouts;
+    unsigned long connects;
+    unsigned long long bytes;
+    double seconds;
+    uint32_t latency_max;
+    unsigned long latency[LAT_BUCKETS];
+} LoadStats;
+
+static LoadStats stats;
+static Conn *conns;
+static int conn_count = 8, depth = 1, keep_alive = 0, timeout_ms = 5000;
+static int epoll_fd;
+static int stopping = 0;
+static struct sockaddr_storage target;
+static socklen_t target_len;
+static char request[512];
+static size_t request_len;
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t percentile(double q) {
+    return latency_percentile(stats.latency, stats.requests, stats.latency_max, q);
+}
+
+static void record_latency(long long us) {
+    uint32_t v = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    if (v > stats.latency_max) stats.latency_max = v;
+    stats.latency[latency_bucket(v)]++;
+}
+
+static void conn_open(Conn *c);
+
+static void conn_close(Conn *c) {
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    c->connected = 0;
+    c->inflight = 0;
+    c->head_done = 0;
+    c->sent_head = 0;
+    c->rlen = 0;
+    c->wlen = c->woff = 0;
+}
+
+static void conn_flush(Conn *c) {
+    while (c->woff < c->wlen) {
+        ssize_t n = send(c->fd, c->wbuf + c->woff, c->wlen - c->woff, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n <= 0) {
+            stats.errors += c->inflight ? c->inflight : 1;
+            conn_close(c);
+            conn_open(c);
+            return;
+        }
+        c->woff += n;
+    }
+    if (c->woff == c->wlen) c->wlen = c->woff = 0;
+    struct epoll_event ev = { .events = EPOLLIN | (c->wlen ? EPOLLOUT : 0), .data.ptr = c };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+/* Tops the connection up to DEPTH outstanding requests. Without keep-alive the
+   clock started at connect(), so the handshake counts towards the latency. */
+static void conn_fill(Conn *c) {
+    int want = keep_alive ? depth : 1;
+    long long now = keep_alive ? now_us() : c->opened_at;
+    while (!stopping && c->inflight < want && c->wlen + request_len <= (size_t)MAX_DEPTH * sizeof(request)) {
+        memcpy(c->wbuf + c->wlen, request, request_len);
+        c->wlen += request_len;
+        c->sent_at[(c->sent_head + c->inflight) % MAX_DEPTH] = now;
+        c->inflight++;
+        if (!keep_alive) break;
+    }
+    conn_flush(c);
+}
+
+static void conn_open(Conn *c) {
+    if (stopping) return;
+    c->fd = socket(target.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd < 0) {
+        perror("socket");
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    stats.connects++;
+    c->opened_at = now_us();
+    if (connect(c->fd, (struct sockaddr *)&target, target_len) < 0 && errno != EINPROGRESS) {
+        stats.errors++;
+        close(c->fd);
+        c->fd = -1;
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = c };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+}
+
+/* One response finished: account for it and queue the next request. */
+static void conn_complete(Conn *c) {
+    long long now = now_us();
+    record_latency(now - c->sent_at[c->sent_head]);
+    c->sent_head = (c->sent_head + 1) % MAX_DEPTH;
+    c->inflight--;
+    c->head_done = 0;
+    stats.requests++;
+    if (c->status < 200 || c->status >= 400) stats.errors++;
+}
+
+static int parse_head(Conn *c) {
+    char *end = memmem(c->rbuf, c->rlen, "\r\n\r\n", 4);
+    if (!end) return 0;
+    *end = '\0';
+    if (sscanf(c->rbuf, "HTTP/%*s %d", &c->status) != 1) c->status = 0;
+    c->body_left = -1;
+    char *cl = strcasestr(c->rbuf, "\r\nContent-Length:");
+    if (cl) c->body_left = atoll(cl + 17);
+    size_t used = end + 4 - c->rbuf;
+    memmove(c->rbuf, c->rbuf + used, c->rlen - used);
+    c->rlen -= used;
+    c->head_done = 1;
+    return 1;
+}
+
+static void conn_read(Conn *c) {
+    while (1) {
+        ssize_t n = recv(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - c->rlen, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n <= 0) {
+            /* A body without Content-Length ends with the connection. */
+            if (c->head_done && c->body_left < 0) conn_complete(c);
+            stats.errors += c->inflight;
+            conn_close(c);
+            conn_open(c);
+            return;
+        }
+        stats.bytes += n;
+        c->rlen += n;
+
+        while (c->inflight) {
+            if (!c->head_done && !parse_head(c)) {
+                if (c->rlen == sizeof(c->rbuf)) c->rlen = 0;
+                break;
+            }
+            if (c->body_left < 0) {
+                c->rlen = 0;
+                break;
+            }
+            size_t take = (size_t)c->body_left < c->rlen ? (size_t)c->body_left : c->rlen;
+            memmove(c->rbuf, c->rbuf + take, c->rlen - take);
+            c->rlen -= take;
+            c->body_left -= take;
+            if (c->body_left > 0) break;
+            conn_complete(c);
+        }
+        if (!keep_alive && !c->inflight) {
+            conn_close(c);
+            conn_open(c);
+            return;
+        }
+        if (keep_alive && c->inflight < depth) {
+            conn_fill(c);
+            if (!c->connected) return;
+        }
+    }
+}
+
+static void conn_event(Conn *c, uint32_t events) {
+    if (!c->connected) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err || (events & (EPOLLERR | EPOLLHUP))) {
+            stats.errors++;
+            conn_close(c);
+            usleep(1000);
+            conn_open(c);
+            return;
+        }
+        c->connected = 1;
+        conn_fill(c);
+        return;
+    }
+    if (events & EPOLLOUT) conn_flush(c);
+    if (c->fd >= 0 && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) conn_read(c);
+}
+
+static void check_timeouts(void) {
+    long long now = now_us();
+    for (int i = 0; i < conn_count; i++) {
+        Conn *c = &conns[i];
+        if (c->fd < 0) {
+            conn_open(c);
+            continue;
+        }
+        long long since = c->connected ? (c->inflight ? c->sent_at[c->sent_head] : now) : c->opened_at;
+        if (now - since > (long long)timeout_ms * 1000) {
+            stats.timeouts += c->inflight ? c->inflight : 1;
+            conn_close(c);
+            conn_open(c);
+        }
+    }
+}
+
+static int resolve_target(const char *spec) {
+    char host[256];
+    const char *colon = strrchr(spec, ':');
+    if (!colon || colon == spec) return -1;
+    const char *h = spec;
+    size_t len = colon - spec;
+    if (h[0] == '[' && colon[-1] == ']') {
+        h++;
+        len -= 2;
+    }
+    if (len >= sizeof(host)) return -1;
+    memcpy(host, h, len);
+    host[len] = '\0';
+
+    struct addrinfo hints = { .ai_socktype = SOCK_STREAM }, *res;
+    if (getaddrinfo(host, colon + 1, &hints, &res) != 0) return -1;
+    memcpy(&target, res->ai_addr, res->ai_addrlen);
+    target_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static void report(void) {
+    printf("requests %lu\n", stats.requests);
+    printf("errors %lu\n", stats.errors);
+    printf("timeouts %lu\n", stats.timeouts);
+    printf("connects %lu\n", stats.connects);
+    printf("seconds %.3f\n", stats.seconds);
+    if (stats.seconds > 0) {
+        printf("requests_per_second %.1f\n", stats.requests / stats.seconds);
+        printf("mbytes_per_second %.2f\n", stats.bytes / stats.seconds / 1e6);
+    }
+    if (stats.requests) {
+        printf("latency_us p50=%u p90=%u p99=%u p999=%u max=%u\n",
+               percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), stats.latency_max);
+    }
+}
+
+/* Load generators run side by side, so their throughputs add up over the longest run. */
+static int merge(char **files, int count) {
+    for (int i = 0; i < count; i++) {
+        LoadStats part;
+        FILE *f = fopen(files[i], "rb");
+        if (!f || fread(&part, sizeof(part), 1, f) != 1) {
+            fprintf(stderr, "%s: cannot read\n", files[i]);
+            if (f) fclose(f);
+            return 1;
+        }
+        fclose(f);
+        stats.requests += part.requests;
+        stats.errors += part.errors;
+        stats.timeouts += part.timeouts;
+        stats.connects += part.connects;
+        stats.bytes += part.bytes;
+        if (part.seconds > stats.seconds) stats.seconds = part.seconds;
+        if (part.latency_max > stats.latency_max) stats.latency_max = part.latency_max;
+        for (int b = 0; b < LAT_BUCKETS; b++) stats.latency[b] += part.latency[b];
+    }
+    report();
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-c CONNS] [-d SECONDS] [-p DEPTH] [-k] [-t TIMEOUT_MS] [-o FILE] HOST:PORT [PATH]\n"
+                    "       %s -m FILE...\n", prog, prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    double duration = 10;
+    const char *out_file = NULL;
+    int merge_mode = 0, opt;
+    while ((opt = getopt(argc, argv, "c:d:p:kt:o:m")) != -1) {
+        if (opt == 'c') conn_count = atoi(optarg);
+        else if (opt == 'd') duration = atof(optarg);
+        else if (opt == 'p') depth = atoi(optarg);
+        else if (opt == 'k') keep_alive = 1;
+        else if (opt == 't') timeout_ms = atoi(optarg);
+        else if (opt == 'o') out_file = optarg;
+        else if (opt == 'm') merge_mode = 1;
+        else usage(argv[0]);
+    }
+    if (merge_mode) return optind < argc ? merge(argv + optind, argc - optind) : 2;
+    if (optind == argc || conn_count < 1 || conn_count > MAX_CONNS || depth < 1 || depth > MAX_DEPTH) usage(argv[0]);
+    if (depth > 1) keep_alive = 1;
+
+    if (resolve_target(argv[optind]) < 0) {
+        fprintf(stderr, "%s: cannot resolve %s\n", argv[0], argv[optind]);
+        return 1;
+    }
+    const char *path = optind + 1 < argc ? argv[optind + 1] : "/";
+    request_len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n",
+                           path, argv[optind], keep_alive ? "" : "Connection: close\r\n");
+    if (request_len >= sizeof(request)) usage(argv[0]);
+
+    epoll_fd = epoll_create1(0);
+    conns = calloc(conn_count, sizeof(Conn));
+    if (!conns) {
+        perror("calloc");
+        return 1;
+    }
+    for (int i = 0; i < conn_count; i++) {
+        conns[i].wbuf = malloc((size_t)MAX_DEPTH * sizeof(request));
+        if (!conns[i].wbuf) {
+            perror("malloc");
+            return 1;
+        }
+        conns[i].fd = -1;
+        conn_open(&conns[i]);
+    }
+
+    struct epoll_event events[256];
+    long long started = now_us(), deadline = started + (long long)(duration * 1e6);
+    long long next_check = started;
+    while (now_us() < deadline) {
+        int n = epoll_wait(epoll_fd, events, 256, 100);
+        for (int i = 0; i < n; i++) conn_event(events[i].data.ptr, events[i].events);
+        if (now_us() >= next_check) {
+            check_timeouts();
+            next_check = now_us() + 100000;
+        }
+    }
+
+    /* Let the requests in flight finish; a server that drops some shows up here. */
+    stopping = 1;
+    long long drain_deadline = now_us() + (long long)timeout_ms * 1000;
+    int pending = 1;
+    while (pending && now_us() < drain_deadline) {
+        int n = epoll_wait(epoll_fd, events, 256, 100);
+        for (int i = 0; i < n; i++) conn_event(events[i].data.ptr, events[i].events);
+        pending = 0;
+        for (int i = 0; i < conn_count; i++) pending |= conns[i].fd >= 0 && conns[i].inflight > 0;
+    }
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].fd >= 0) stats.errors += conns[i].inflight;
+    }
+    stats.seconds = (now_us() - started) / 1e6;
+
+    if (out_file) {
+        FILE *f = fopen(out_file, "wb");
+        if (!f || fwrite(&stats, sizeof(stats), 1, f) != 1) {
+            perror(out_file);
+            return 1;
+        }
+        fclose(f);
+    }
+    report();
+    return 0;
+}
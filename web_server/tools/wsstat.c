@@ -0,0 +1,62 @@
+/* Reads the server's shared statistics block without touching the server.
+ *
+ *   wsstat [-p PORT | -s NAME] [-w]      totals (-w: also one line per worker slot)
+ *   wsstat [-p PORT | -s NAME] drain     stop accepting, let in-flight work finish
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/stats.h"
+
+int main(int argc, char **argv) {
+    char name[64] = "/webserver.8080";
+    int per_slot = 0, opt;
+    while ((opt = getopt(argc, argv, "p:s:w")) != -1) {
+        if (opt == 'p') snprintf(name, sizeof(name), "/webserver.%d", atoi(optarg));
+        else if (opt == 's') snprintf(name, sizeof(name), "%s", optarg);
+        else if (opt == 'w') per_slot = 1;
+        else {
+            fprintf(stderr, "usage: %s [-p PORT | -s NAME] [-w] [drain]\n", argv[0]);
+            return 2;
+        }
+    }
+    int drain = optind < argc && strcmp(argv[optind], "drain") == 0;
+
+    StatsShared *shared = stats_open(name, drain);
+    if (!shared) {
+        fprintf(stderr, "%s: cannot open statistics block %s\n", argv[0], name);
+        return 1;
+    }
+
+    if (drain) {
+        __atomic_store_n(&shared->control.drain, 1, __ATOMIC_RELAXED);
+        printf("drain requested for pid %d\n", shared->control.master_pid);
+        return 0;
+    }
+
+    StatsTotals totals;
+    stats_sum(shared, &totals);
+    printf("master_pid %d\n", shared->control.master_pid);
+    printf("uptime_seconds %ld\n", (long)time(NULL) - shared->control.started_at);
+    printf("config_generation %lu\n", __atomic_load_n(&shared->control.config_generation, __ATOMIC_RELAXED));
+    printf("draining %d\n", __atomic_load_n(&shared->control.drain, __ATOMIC_RELAXED));
+    printf("workers %d\n", totals.workers);
+    printf("active_connections %ld\n", totals.active);
+    printf("requests_total %lu\n", totals.requests);
+    printf("errors_total %lu\n", totals.errors);
+    printf("bytes_in_total %llu\n", totals.bytes_in);
+    printf("bytes_out_total %llu\n", totals.bytes_out);
+
+    for (int i = 0; per_slot && i < STATS_MAX_SLOTS; i++) {
+        const StatsSlot *slot = &shared->slots[i];
+        unsigned long requests = __atomic_load_n(&slot->requests, __ATOMIC_RELAXED);
+        if (!requests) continue;
+        printf("slot %d pid=%d active=%ld requests=%lu errors=%lu bytes_in=%llu bytes_out=%llu\n", i,
+               __atomic_load_n(&slot->pid, __ATOMIC_RELAXED), __atomic_load_n(&slot->active, __ATOMIC_RELAXED),
+               requests, __atomic_load_n(&slot->errors, __ATOMIC_RELAXED),
+               __atomic_load_n(&slot->bytes_in, __ATOMIC_RELAXED), __atomic_load_n(&slot->bytes_out, __ATOMIC_RELAXED));
+    }
+    return 0;
+}